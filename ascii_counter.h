@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Decimal counter that is stored as ASCII digits, so it can be copied into
+// the output as is. Incrementing touches only the digits that change.
+class AsciiCounter {
+public:
+    explicit AsciiCounter(std::uint64_t start = 1) : first_(sizeof(digits_)) {
+        do {
+            digits_[--first_] = static_cast<char>('0' + start % 10);
+            start /= 10;
+        } while (start != 0);
+    }
+
+    void increment() {
+        std::size_t i = sizeof(digits_);
+        while (i > first_ && digits_[i - 1] == '9') {
+            digits_[--i] = '0';
+        }
+        if (i == first_) {
+            digits_[--first_] = '1';
+        } else {
+            ++digits_[i - 1];
+        }
+    }
+
+    std::string_view view() const {
+        return std::string_view(digits_ + first_, sizeof(digits_) - first_);
+    }
+
+private:
+    char digits_[20];
+    std::size_t first_;
+};
@@ -0,0 +1,98 @@
+#include "audit_log.h"
+
+#include <stdexcept>
+
+#include "file_sync.h"
+
+AuditLog::AuditLog(const std::string& path) : file_(std::fopen(path.c_str(), "ab")) {
+    if (file_ == nullptr) {
+        throw std::runtime_error("cannot open audit log " + path);
+    }
+    writer_ = std::thread(&AuditLog::run, this);
+}
+
+AuditLog::~AuditLog() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_writer_.notify_one();
+    writer_.join();
+    std::fclose(file_);
+}
+
+void AuditLog::write(std::string_view lines, const std::vector<Stamp>& stamps) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    wake_callers_.wait(lock, [this] { return pending_.bytes.size() < max_pending || failed_; });
+    if (failed_) {
+        throw std::runtime_error("audit log write failed");
+    }
+    bool was_empty = pending_.bytes.empty();
+    std::size_t base = pending_.bytes.size();
+    pending_.bytes.append(lines);
+    for (const Stamp& stamp : stamps) {
+        pending_.stamps.push_back({stamp.time, base + stamp.end});
+    }
+    if (was_empty) {
+        ++recorded_;
+        lock.unlock();
+        wake_writer_.notify_one();
+    }
+}
+
+void AuditLog::sync() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::uint64_t target = recorded_;
+    wake_callers_.wait(lock, [&] { return committed_ >= target || failed_; });
+    if (failed_) {
+        throw std::runtime_error("audit log write failed");
+    }
+}
+
+void AuditLog::run() {
+    Batch batch;
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        wake_writer_.wait(lock, [this] { return !pending_.bytes.empty() || stop_; });
+        if (pending_.bytes.empty()) {
+            return;
+        }
+        // Everything queued while the previous batch was being synced goes
+        // out with a single write and a single fdatasync.
+        std::swap(batch, pending_);
+        std::uint64_t batch_number = recorded_;
+        lock.unlock();
+        wake_callers_.notify_all();
+        bool ok = true;
+        try {
+            commit(batch);
+        } catch (const std::exception&) {
+            ok = false;
+        }
+        batch.bytes.clear();
+        batch.stamps.clear();
+        lock.lock();
+        committed_ = batch_number;
+        failed_ = failed_ || !ok;
+        wake_callers_.notify_all();
+    }
+}
+
+void AuditLog::commit(const Batch& batch) {
+    std::string out;
+    out.reserve(batch.bytes.size() + batch.bytes.size() / 4);
+    std::size_t begin = 0;
+    for (const auto& stamp : batch.stamps) {
+        std::string prefix = std::to_string(stamp.time) + ' ';
+        while (begin < stamp.end) {
+            std::size_t end = batch.bytes.find('\n', begin);
+            end = (end == std::string::npos || end >= stamp.end) ? stamp.end : end + 1;
+            out += prefix;
+            out.append(batch.bytes, begin, end - begin);
+            begin = end;
+        }
+    }
+    if (std::fwrite(out.data(), 1, out.size(), file_) != out.size() || !sync_file(file_)) {
+        throw std::runtime_error("audit log write failed");
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "output_buffer.h"
+
+// Append-only audit log of emitted greetings, fed as the tap of an
+// OutputBuffer. The emitting thread only copies the output into a pending
+// batch; a background thread writes each batch and makes it durable with
+// one fdatasync (group commit). Every greeting line is logged as
+// "<unix time in ns> <line>", with the time the line was committed to the
+// output buffer.
+class AuditLog : public Tap {
+public:
+    explicit AuditLog(const std::string& path);
+    ~AuditLog() override;
+
+    AuditLog(const AuditLog&) = delete;
+    AuditLog& operator=(const AuditLog&) = delete;
+
+    // Queues whole newline-terminated lines, each stamped with the time of
+    // the first stamp that covers it. Blocks only if the writer is more than
+    // max_pending bytes behind.
+    void write(std::string_view lines, const std::vector<Stamp>& stamps) override;
+
+    // Waits until everything recorded so far is on disk.
+    void sync();
+
+private:
+    struct Batch {
+        std::string bytes;
+        std::vector<Stamp> stamps; // end offsets into bytes
+    };
+
+    static constexpr std::size_t max_pending = 64 << 20;
+
+    void run();
+    void commit(const Batch& batch);
+
+    std::FILE* file_;
+    std::mutex mutex_;
+    std::condition_variable wake_writer_;
+    std::condition_variable wake_callers_;
+    Batch pending_;
+    std::uint64_t recorded_ = 0;  // batches recorded
+    std::uint64_t committed_ = 0; // batches durable
+    bool stop_ = false;
+    bool failed_ = false;
+    std::thread writer_;
+};
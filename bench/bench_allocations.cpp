@@ -0,0 +1,181 @@
+// Counts heap allocations per greeting in each output mode, through the
+// counting operator new of counting_new.cpp, and times each mode. Every
+// mode runs twice, with a short and a long name list, and the difference
+// is divided by the extra names, so buffers set up once per run cancel out
+// and only the per-greeting cost is left. test_allocations fails the build's
+// tests when an allocation-free mode starts allocating; this reports the
+// figures for every mode.
+//
+// Usage: bench_allocations [names], with at least 2 names
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "counting_new.h"
+#include "greeting.h"
+#include "greeting_jobs.h"
+#include "names_mode.h"
+#include "output_buffer.h"
+
+namespace {
+
+class NullSink : public Sink {
+public:
+    void write(std::string_view data) override {
+        bytes += data.size();
+    }
+
+    std::size_t bytes = 0;
+};
+
+struct Count {
+    std::uint64_t allocations;
+    std::uint64_t bytes;
+};
+
+Count measure(const std::function<void()>& run) {
+    std::uint64_t before = counting_new::allocations();
+    std::uint64_t bytes_before = counting_new::bytes();
+    run();
+    return {counting_new::allocations() - before, counting_new::bytes() - bytes_before};
+}
+
+// Mostly plain names, with some that need JSON escaping and some non-ASCII
+// ones; every fifth JSON Lines record has a locale.
+std::string name_at(std::size_t i) {
+    static const char* stems[] = {"recipient", "Zo\xc3\xab", "O'Brien", "\xe7\x8e\x8b\xe5\xb0\x8f\xe6\x98\x8e"};
+    return stems[i % 4] + std::string("-") + std::to_string(i);
+}
+
+std::filesystem::path write_names(std::size_t count, InputFormat format) {
+    static const char* locales[] = {"de", "fr", "es", "xx", "pt-BR"};
+    std::filesystem::path path = std::filesystem::temp_directory_path() /
+                                 ("bench_allocations_" + std::to_string(count) +
+                                  (format == InputFormat::jsonl ? ".jsonl" : ".txt"));
+    std::ofstream out(path, std::ios::binary);
+    for (std::size_t i = 0; i < count; ++i) {
+        if (format == InputFormat::text) {
+            out << name_at(i) << '\n';
+        } else if (i % 5 == 0) {
+            out << "{\"name\":\"" << name_at(i) << "\",\"locale\":\"" << locales[i / 5 % 5] << "\"}\n";
+        } else {
+            out << "{\"name\":\"" << name_at(i) << (i % 7 == 0 ? "\\t" : "") << "\"}\n";
+        }
+    }
+    return path;
+}
+
+struct Mode {
+    const char* name;
+    std::function<void(std::size_t)> run; // greets the given number of names
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::size_t large = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    if (large < 2) {
+        // The per-name figures divide by the names the long run adds.
+        std::fprintf(stderr, "usage: bench_allocations [names], with at least 2 names\n");
+        return 2;
+    }
+    std::size_t small = std::max<std::size_t>(1, large / 10);
+
+    std::vector<std::filesystem::path> files;
+    auto names_file = [&](std::size_t count, InputFormat format) {
+        files.push_back(write_names(count, format));
+        return files.back().string();
+    };
+    std::string text_files[2] = {names_file(small, InputFormat::text), names_file(large, InputFormat::text)};
+    std::string jsonl_files[2] = {names_file(small, InputFormat::jsonl), names_file(large, InputFormat::jsonl)};
+
+    auto names_mode = [&](NamesOptions options) {
+        return [options, &text_files, &jsonl_files, large](std::size_t count) mutable {
+            std::string* paths = options.input_format == InputFormat::jsonl ? jsonl_files : text_files;
+            options.path = paths[count == large ? 1 : 0];
+            NullSink sink;
+            OutputBuffer out(sink);
+            emit_names(options, out);
+            out.flush();
+        };
+    };
+    auto with = [](std::function<void(NamesOptions&)> set) {
+        NamesOptions options;
+        set(options);
+        return options;
+    };
+
+    std::vector<std::string> names;
+    for (std::size_t i = 0; i < large; ++i) {
+        names.push_back(name_at(i));
+    }
+    std::vector<std::string_view> views(names.begin(), names.end());
+    GreetingCatalog catalog;
+
+    std::vector<Mode> modes = {
+        {"write_greeting",
+         [&](std::size_t count) {
+             NullSink sink;
+             OutputBuffer out(sink);
+             for (std::size_t i = 0; i < count; ++i) {
+                 char* p = out.reserve(greeting_size(views[i]) + 1);
+                 *write_greeting(p, views[i]) = '\n';
+                 out.commit(greeting_size(views[i]) + 1);
+             }
+             out.flush();
+         }},
+        {"greet_many (batches of 4096)",
+         [&](std::size_t count) {
+             GreetingBatch batch;
+             for (std::size_t i = 0; i < count; i += 4096) {
+                 greet_many(views.data() + i, std::min<std::size_t>(4096, count - i), batch);
+             }
+         }},
+        {"greet_jobs (batches of 4096)",
+         [&](std::size_t count) {
+             static const char* locales[] = {"", "de", "fr", "pt-BR"};
+             GreetingJobs jobs;
+             GreetingBatch batch;
+             for (std::size_t i = 0; i < count; ++i) {
+                 jobs.add(views[i], locales[i % 4], catalog);
+                 if (jobs.size() == 4096 || i + 1 == count) {
+                     greet_jobs(jobs, catalog, batch);
+                     jobs.clear();
+                 }
+             }
+         }},
+        {"--names", names_mode(NamesOptions())},
+        {"--names --format jsonl", names_mode(with([](NamesOptions& o) { o.format = OutputFormat::jsonl; }))},
+        {"--names --format binary", names_mode(with([](NamesOptions& o) { o.format = OutputFormat::binary; }))},
+        {"--names --input-format jsonl",
+         names_mode(with([](NamesOptions& o) { o.input_format = InputFormat::jsonl; }))},
+        {"--names --dedup", names_mode(with([](NamesOptions& o) { o.dedup = true; }))},
+        {"--names --threads 4", names_mode(with([](NamesOptions& o) { o.threads = 4; }))},
+        {"--names --sort", names_mode(with([](NamesOptions& o) { o.sort = true; }))},
+    };
+
+    std::printf("%-30s %12s %12s %10s\n", "mode", "allocs/name", "bytes/name", "ns/name");
+    for (const auto& mode : modes) {
+        Count first = measure([&] { mode.run(small); });
+        auto start = std::chrono::steady_clock::now();
+        Count second = measure([&] { mode.run(large); });
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double extra = static_cast<double>(large - small);
+        double per_name = (static_cast<double>(second.allocations) - static_cast<double>(first.allocations)) / extra;
+        double bytes = (static_cast<double>(second.bytes) - static_cast<double>(first.bytes)) / extra;
+        std::printf("%-30s %12.4f %12.1f %10.1f\n", mode.name, per_name, bytes, seconds * 1e9 / large);
+    }
+
+    for (const auto& path : files) {
+        std::filesystem::remove(path);
+    }
+    return 0;
+}
@@ -0,0 +1,87 @@
+// Counts greetings and bytes from several threads at once into a single
+// shared pair of atomics, into per-thread slots packed next to each other
+// (false sharing), and into ThreadCounters' cache-line padded slots, and
+// reports the time per count of each.
+//
+// Usage: bench_counters [threads] [millions per thread]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "thread_counters.h"
+
+namespace {
+
+// Runs count(thread) on every thread at once; returns nanoseconds per count.
+double run(unsigned threads, std::uint64_t per_thread, const std::function<void(unsigned, std::uint64_t)>& count) {
+    std::atomic<unsigned> ready{0};
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            ready.fetch_add(1);
+            while (ready.load() < threads) {
+            }
+            count(t, per_thread);
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return seconds * 1e9 / (static_cast<double>(per_thread) * threads);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    unsigned threads = argc > 1 ? static_cast<unsigned>(std::strtoul(argv[1], nullptr, 10))
+                                : std::max(2u, std::thread::hardware_concurrency());
+    std::uint64_t per_thread = (argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 20) * 1000000;
+    std::uint64_t expected = per_thread * threads;
+    std::printf("%u threads, %llu counts each\n", threads, static_cast<unsigned long long>(per_thread));
+
+    std::atomic<std::uint64_t> shared_greetings{0};
+    std::atomic<std::uint64_t> shared_bytes{0};
+    double ns = run(threads, per_thread, [&](unsigned, std::uint64_t n) {
+        for (std::uint64_t i = 0; i < n; ++i) {
+            shared_greetings.fetch_add(1, std::memory_order_relaxed);
+            shared_bytes.fetch_add(12, std::memory_order_relaxed);
+        }
+    });
+    std::printf("%-28s %8.2f ns/count\n", "shared atomic", ns);
+    bool correct = shared_greetings.load() == expected;
+
+    struct Packed {
+        std::atomic<std::uint64_t> greetings{0};
+        std::atomic<std::uint64_t> bytes{0};
+    };
+    std::unique_ptr<Packed[]> packed(new Packed[threads]);
+    ns = run(threads, per_thread, [&](unsigned t, std::uint64_t n) {
+        Packed& slot = packed[t];
+        for (std::uint64_t i = 0; i < n; ++i) {
+            slot.greetings.store(slot.greetings.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            slot.bytes.store(slot.bytes.load(std::memory_order_relaxed) + 12, std::memory_order_relaxed);
+        }
+    });
+    std::printf("%-28s %8.2f ns/count\n", "packed per-thread slots", ns);
+
+    ThreadCounters counters(threads);
+    ns = run(threads, per_thread, [&](unsigned, std::uint64_t n) {
+        std::size_t slot = counters.add_thread();
+        for (std::uint64_t i = 0; i < n; ++i) {
+            counters.add(slot, 12);
+        }
+    });
+    std::printf("%-28s %8.2f ns/count\n", "ThreadCounters", ns);
+    correct = correct && counters.read().greetings == expected && counters.read().bytes == 12 * expected;
+    return correct ? 0 : 1;
+}
@@ -0,0 +1,92 @@
+// Parses the same greetings as newline-delimited text and as the binary
+// framing of `hello --format binary` and reports the time of both.
+//
+// Usage: bench_frame_reader [records]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "frame_format.h"
+#include "frame_reader.h"
+
+namespace {
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Same layout FrameWriter produces: batches of about 64 KiB.
+std::string encode_frames(const std::vector<std::string>& records) {
+    std::string stream;
+    std::string body;
+    std::uint32_t count = 0;
+    auto flush = [&] {
+        char header[frame_format::header_size];
+        std::memcpy(header, frame_format::magic, sizeof(frame_format::magic));
+        frame_format::put_u32(header + 4, count);
+        frame_format::put_u32(header + 8, static_cast<std::uint32_t>(body.size()));
+        stream.append(header, sizeof(header)).append(body);
+        body.clear();
+        count = 0;
+    };
+    for (const auto& record : records) {
+        char prefix[16];
+        body.append(prefix, frame_format::put_varint(prefix, record.size()) - prefix).append(record);
+        if (++count, body.size() >= (1 << 16)) {
+            flush();
+        }
+    }
+    if (count != 0) {
+        flush();
+    }
+    return stream;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20000000;
+
+    std::mt19937_64 random(42);
+    std::vector<std::string> records(count);
+    std::string text;
+    for (auto& record : records) {
+        record = "Hello, recipient-" + std::to_string(random() % 1000000);
+        text.append(record).push_back('\n');
+    }
+    std::string frames = encode_frames(records);
+
+    auto start = std::chrono::steady_clock::now();
+    std::size_t text_records = 0;
+    std::size_t text_bytes = 0;
+    for (std::size_t begin = 0; begin < text.size();) {
+        const char* newline = static_cast<const char*>(std::memchr(text.data() + begin, '\n', text.size() - begin));
+        std::size_t stop = newline != nullptr ? static_cast<std::size_t>(newline - text.data()) : text.size();
+        ++text_records;
+        text_bytes += stop - begin;
+        begin = stop + 1;
+    }
+    double text_time = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    FrameParser parser(frames);
+    std::size_t frame_records = 0;
+    std::size_t frame_bytes = 0;
+    for (std::string_view record; parser.next(record);) {
+        ++frame_records;
+        frame_bytes += record.size();
+    }
+    double frame_time = seconds_since(start);
+
+    std::printf("%zu records, %.1f MiB text, %.1f MiB framed\n", count, text.size() / 1048576.0,
+                frames.size() / 1048576.0);
+    std::printf("newline scan: %7.3f s %6.2f ns/record\n", text_time, text_time * 1e9 / count);
+    std::printf("frames:       %7.3f s %6.2f ns/record\n", frame_time, frame_time * 1e9 / count);
+    return text_records == frame_records && text_bytes == frame_bytes ? 0 : 1;
+}
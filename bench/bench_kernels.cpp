@@ -0,0 +1,88 @@
+// Times the dispatched kernels at every instruction set level the host
+// supports: UTF-8 validation directly per level, JSON escaping and JSON
+// Lines parsing at the level picked at startup (run with HELLO_CPU set to
+// compare levels).
+//
+// Usage: bench_kernels [megabytes]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cpu_dispatch.h"
+#include "json_escape.h"
+#include "jsonl_parser.h"
+#include "utf8.h"
+
+namespace {
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void report(const char* name, double seconds, std::size_t bytes) {
+    std::printf("%-28s %7.3f s %8.2f GB/s\n", name, seconds, bytes / seconds / 1e9);
+}
+
+template <typename F>
+void time_validator(const char* name, F validate, const std::string& text) {
+    auto start = std::chrono::steady_clock::now();
+    bool valid = validate(text.data(), text.size());
+    report(name, seconds_since(start), text.size());
+    if (!valid) {
+        std::printf("  rejected valid input\n");
+        std::exit(1);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::size_t megabytes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 256;
+
+    // Mostly ASCII names with some accented and CJK ones, as JSON Lines.
+    std::mt19937_64 random(42);
+    const char* names[] = {"recipient", "Zo\xc3\xab", "\xe7\x8e\x8b\xe5\xb0\x8f\xe6\x98\x8e", "O\"Brien"};
+    std::string text;
+    std::vector<std::string> values;
+    while (text.size() < megabytes << 20) {
+        std::string name = std::string(names[random() % 4]) + "-" + std::to_string(random() % 1000000);
+        char escaped[json_escaped_bound(64)];
+        std::string_view json(escaped, write_json_escaped(escaped, name) - escaped);
+        text += "{\"id\":" + std::to_string(values.size()) + ",\"name\":\"";
+        text.append(json.data(), json.size()).append("\"}\n");
+        values.push_back(std::move(name));
+    }
+
+    std::printf("host level %s, %zu MiB\n", cpu_level_name(cpu_level()), megabytes);
+    time_validator("utf8 ascii fast path", validate_utf8_ascii_fast_path, text);
+#ifdef HELLO_X86_DISPATCH
+    if (cpu_level() >= CpuLevel::avx2) {
+        time_validator("utf8 avx2", validate_utf8_avx2, text);
+    }
+    if (cpu_level() >= CpuLevel::avx512) {
+        time_validator("utf8 avx512", validate_utf8_avx512, text);
+    }
+#endif
+
+    std::vector<char> out(json_escaped_bound(64));
+    std::size_t escaped = 0;
+    std::size_t bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& value : values) {
+        escaped += write_json_escaped(out.data(), value) - out.data();
+        bytes += value.size();
+    }
+    report("json escape", seconds_since(start), bytes);
+
+    JsonlNameParser parser;
+    std::size_t records = 0;
+    start = std::chrono::steady_clock::now();
+    parser.parse(text, [&](std::string_view, std::string_view) { ++records; });
+    report("jsonl parse", seconds_since(start), text.size());
+    return records == values.size() && escaped >= bytes ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+// Deduplicates a synthetic name list with NameSet and with
+// std::unordered_set<std::string> and reports time and memory of both.
+//
+// Usage: bench_name_set [names] [distinct]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "name_set.h"
+
+namespace {
+
+std::size_t allocated = 0;
+
+// Counts the bytes std::unordered_set allocates for nodes and buckets.
+template <typename T>
+struct CountingAllocator {
+    using value_type = T;
+
+    CountingAllocator() = default;
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>&) {}
+
+    T* allocate(std::size_t n) {
+        allocated += n * sizeof(T);
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* p, std::size_t n) {
+        allocated -= n * sizeof(T);
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    template <typename U>
+    bool operator==(const CountingAllocator<U>&) const {
+        return true;
+    }
+    template <typename U>
+    bool operator!=(const CountingAllocator<U>&) const {
+        return false;
+    }
+};
+
+using CountedString = std::basic_string<char, std::char_traits<char>, CountingAllocator<char>>;
+
+struct CountedHash {
+    std::size_t operator()(const CountedString& s) const {
+        return std::hash<std::string_view>()(std::string_view(s.data(), s.size()));
+    }
+};
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20000000;
+    std::size_t distinct = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : count / 2;
+
+    std::mt19937_64 random(42);
+    std::vector<std::string> names(count);
+    for (auto& name : names) {
+        name = "recipient-" + std::to_string(random() % distinct);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    NameArena arena;
+    NameSet set(arena);
+    for (const auto& name : names) {
+        set.insert(name);
+    }
+    double set_time = seconds_since(start);
+    std::size_t set_memory = set.memory_usage() + arena.capacity_bytes();
+
+    start = std::chrono::steady_clock::now();
+    std::unordered_set<CountedString, CountedHash, std::equal_to<CountedString>, CountingAllocator<CountedString>> std_set;
+    for (const auto& name : names) {
+        std_set.insert(CountedString(name.data(), name.size()));
+    }
+    double std_time = seconds_since(start);
+
+    std::printf("%zu names, %zu distinct\n", count, set.size());
+    std::printf("NameSet:            %7.3f s %8.1f ns/name %8.1f MiB\n", set_time, set_time * 1e9 / count,
+                set_memory / 1048576.0);
+    std::printf("std::unordered_set: %7.3f s %8.1f ns/name %8.1f MiB\n", std_time, std_time * 1e9 / count,
+                allocated / 1048576.0);
+    return std_set.size() == set.size() ? 0 : 1;
+}
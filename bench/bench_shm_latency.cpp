@@ -0,0 +1,92 @@
+// Round-trip latency of the shared-memory greeting service with the
+// server sleeping on its doorbell when idle and with --busy-poll. Requests
+// go back to back and then spaced out, so the sleeping server has gone
+// idle and must be woken; each run prints percentiles and a histogram with
+// power-of-two buckets.
+//
+// Usage: bench_shm_latency [requests] [gap microseconds], with at least 1 request
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "shm_channel.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+void report(const char* name, std::vector<std::uint64_t>& ns) {
+    std::sort(ns.begin(), ns.end());
+    auto at = [&](double q) { return ns[std::min(ns.size() - 1, static_cast<std::size_t>(q * ns.size()))]; };
+    std::printf("%s: p50 %llu ns, p99 %llu ns, p99.9 %llu ns, max %llu ns\n", name,
+                static_cast<unsigned long long>(at(0.5)), static_cast<unsigned long long>(at(0.99)),
+                static_cast<unsigned long long>(at(0.999)), static_cast<unsigned long long>(ns.back()));
+    std::size_t buckets[64] = {};
+    for (std::uint64_t v : ns) {
+        unsigned b = 0;
+        while ((v >> (b + 1)) != 0) {
+            ++b;
+        }
+        ++buckets[b];
+    }
+    std::size_t widest = *std::max_element(std::begin(buckets), std::end(buckets));
+    for (unsigned b = 0; b < 64; ++b) {
+        if (buckets[b] == 0) {
+            continue;
+        }
+        std::printf("  < %10llu ns %8zu %s\n", 2ull << b, buckets[b], std::string(buckets[b] * 50 / widest, '#').c_str());
+    }
+}
+
+void measure(bool busy_poll, std::size_t requests, std::chrono::microseconds gap) {
+    const std::string name = "/hello-bench-latency";
+    std::atomic<bool> stop{false};
+    ShmGreetingServer server(name);
+    std::thread serving([&] { server.run(stop, busy_poll); });
+    {
+        ShmGreetingClient client(name);
+        for (int i = 0; i < 1000; ++i) {
+            client.greet("warmup");
+        }
+        for (auto pause : {std::chrono::microseconds(0), gap}) {
+            std::vector<std::uint64_t> ns;
+            ns.reserve(requests);
+            for (std::size_t i = 0; i < requests; ++i) {
+                if (pause.count() != 0) {
+                    std::this_thread::sleep_for(pause);
+                }
+                auto start = Clock::now();
+                client.greet("recipient");
+                ns.push_back(static_cast<std::uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count()));
+            }
+            std::string label = std::string(busy_poll ? "busy poll" : "sleeping server") +
+                                (pause.count() == 0 ? ", back to back" : ", " + std::to_string(pause.count()) + " us apart");
+            report(label.c_str(), ns);
+        }
+    }
+    stop.store(true);
+    serving.join();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::size_t requests = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20000;
+    if (requests == 0) {
+        // The percentiles index into the measured requests.
+        std::fprintf(stderr, "usage: bench_shm_latency [requests] [gap microseconds], with at least 1 request\n");
+        return 2;
+    }
+    std::chrono::microseconds gap(argc > 2 ? std::strtoll(argv[2], nullptr, 10) : 200);
+    measure(false, requests, gap);
+    measure(true, requests, gap);
+    return 0;
+}
@@ -0,0 +1,424 @@
+#include "counter_store.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+
+#include "file_sync.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char segment_magic[4] = {'H', 'C', 'S', '2'};
+
+using Entries = std::vector<std::pair<std::string, std::uint64_t>>;
+
+void write_all(std::FILE* file, const void* data, std::size_t size) {
+    if (std::fwrite(data, 1, size, file) != size) {
+        throw std::runtime_error("counter store write failed");
+    }
+}
+
+void read_all(std::FILE* file, void* data, std::size_t size, const std::string& path) {
+    if (std::fread(data, 1, size, file) != size) {
+        throw std::runtime_error("corrupt counter segment " + path);
+    }
+}
+
+void seek(std::FILE* file, std::uint64_t offset, const std::string& path) {
+#ifdef _WIN32
+    bool ok = _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+    bool ok = fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+    if (!ok) {
+        throw std::runtime_error("corrupt counter segment " + path);
+    }
+}
+
+using File = std::unique_ptr<std::FILE, int (*)(std::FILE*)>;
+
+File open_file(const std::string& path) {
+    File file(std::fopen(path.c_str(), "rb"), std::fclose);
+    if (!file) {
+        throw std::runtime_error("cannot open counter segment " + path);
+    }
+    return file;
+}
+
+// Writes path atomically: into a temporary file that is synced and then
+// renamed over path, after which the directory is synced too.
+template <typename Write>
+void replace_file(const fs::path& path, Write write) {
+    std::random_device random;
+    fs::path temp = path;
+    temp += "." + std::to_string(random()) + ".tmp";
+    std::FILE* file = std::fopen(temp.string().c_str(), "wb");
+    if (file == nullptr) {
+        throw std::runtime_error("cannot create " + temp.string());
+    }
+    try {
+        write(file);
+        if (!sync_file(file)) {
+            throw std::runtime_error("cannot write " + temp.string());
+        }
+    } catch (...) {
+        std::fclose(file);
+        fs::remove(temp);
+        throw;
+    }
+    std::fclose(file);
+    fs::rename(temp, path);
+    if (!sync_directory(path.parent_path().string())) {
+        throw std::runtime_error("cannot sync " + path.parent_path().string());
+    }
+}
+
+// Appends entries in name order, then their offsets and the count.
+class SegmentWriter {
+public:
+    explicit SegmentWriter(std::FILE* file) : file_(file) {
+        write_all(file_, segment_magic, sizeof(segment_magic));
+        offset_ = sizeof(segment_magic);
+    }
+
+    void add(std::string_view name, std::uint64_t value) {
+        if (name.size() > UINT32_MAX) {
+            throw std::length_error("name too long for the counter store");
+        }
+        std::uint32_t length = static_cast<std::uint32_t>(name.size());
+        offsets_.push_back(offset_);
+        write_all(file_, &length, sizeof(length));
+        write_all(file_, name.data(), length);
+        write_all(file_, &value, sizeof(value));
+        offset_ += sizeof(length) + length + sizeof(value);
+    }
+
+    // Returns the offset of the index.
+    std::uint64_t finish() {
+        std::uint64_t count = offsets_.size();
+        write_all(file_, offsets_.data(), offsets_.size() * sizeof(std::uint64_t));
+        write_all(file_, &count, sizeof(count));
+        return offset_;
+    }
+
+    std::uint64_t count() const {
+        return offsets_.size();
+    }
+
+private:
+    std::FILE* file_;
+    std::uint64_t offset_;
+    std::vector<std::uint64_t> offsets_;
+};
+
+// Reads the entries of a segment in order.
+class SegmentReader {
+public:
+    SegmentReader(const std::string& path, std::uint64_t count)
+        : path_(path), file_(open_file(path)), remaining_(count) {
+        std::setvbuf(file_.get(), nullptr, _IOFBF, 1 << 16);
+        char magic[4];
+        read_all(file_.get(), magic, sizeof(magic), path_);
+    }
+
+    bool next() {
+        if (remaining_ == 0) {
+            return false;
+        }
+        std::uint32_t length;
+        read_all(file_.get(), &length, sizeof(length), path_);
+        name_.resize(length);
+        read_all(file_.get(), &name_[0], length, path_);
+        read_all(file_.get(), &value_, sizeof(value_), path_);
+        --remaining_;
+        return true;
+    }
+
+    const std::string& name() const {
+        return name_;
+    }
+
+    std::uint64_t value() const {
+        return value_;
+    }
+
+private:
+    std::string path_;
+    File file_;
+    std::uint64_t remaining_;
+    std::string name_;
+    std::uint64_t value_ = 0;
+};
+
+} // namespace
+
+CounterStore::Segment::Segment(std::string file, std::string path) : file(std::move(file)), path(std::move(path)) {}
+
+CounterStore::Segment::~Segment() {
+    if (obsolete.load()) {
+        std::error_code ignored;
+        fs::remove(path, ignored);
+    }
+}
+
+CounterStore::CounterStore(const std::string& dir) : dir_(dir) {
+    fs::create_directories(dir_);
+    lock_ = std::make_unique<FileLock>((fs::path(dir_) / "LOCK").string());
+    auto state = std::make_shared<State>();
+    std::ifstream manifest(fs::path(dir_) / "MANIFEST");
+    std::string file;
+    while (std::getline(manifest, file)) {
+        if (file.empty()) {
+            continue;
+        }
+        state->segments.push_back(open_segment(file));
+        next_segment_ = std::max<std::uint64_t>(next_segment_, std::strtoull(file.c_str() + 4, nullptr, 10) + 1);
+    }
+    state_ = state;
+    worker_ = std::thread(&CounterStore::run, this);
+}
+
+CounterStore::~CounterStore() {
+    stop();
+}
+
+void CounterStore::close() {
+    stop();
+    if (failed_) {
+        throw std::runtime_error("cannot write counter store " + dir_);
+    }
+}
+
+// Freezes the last table and waits for the worker to write it out.
+void CounterStore::stop() {
+    if (!worker_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!table_.empty()) {
+            auto state = std::make_shared<State>(*state_);
+            state->frozen.push_back(std::make_shared<const Table>(std::move(table_)));
+            state_ = state;
+            table_ = Table();
+        }
+        stop_ = true;
+    }
+    wake_.notify_one();
+    worker_.join();
+}
+
+void CounterStore::add_batch(const std::vector<std::string>& names) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (failed_) {
+        throw std::runtime_error("cannot write counter store " + dir_);
+    }
+    for (const std::string& name : names) {
+        ++table_[name];
+    }
+    if (table_.size() < table_limit) {
+        return;
+    }
+    // Freezing is a pointer move; the table is written out by the worker.
+    auto state = std::make_shared<State>(*state_);
+    state->frozen.push_back(std::make_shared<const Table>(std::move(table_)));
+    state_ = state;
+    table_ = Table();
+    lock.unlock();
+    wake_.notify_one();
+}
+
+std::uint64_t CounterStore::lookup(std::string_view name) const {
+    std::uint64_t count = 0;
+    std::shared_ptr<const State> state;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = table_.find(std::string(name));
+        if (it != table_.end()) {
+            count += it->second;
+        }
+        state = state_;
+    }
+    for (const auto& table : state->frozen) {
+        auto it = table->find(std::string(name));
+        if (it != table->end()) {
+            count += it->second;
+        }
+    }
+    std::string key;
+    for (const auto& segment : state->segments) {
+        // Binary search through the offset index.
+        File file = open_file(segment->path);
+        std::uint64_t low = 0;
+        std::uint64_t high = segment->count;
+        while (low < high) {
+            std::uint64_t middle = low + (high - low) / 2;
+            std::uint64_t offset;
+            std::uint32_t length;
+            seek(file.get(), segment->index_offset + middle * sizeof(offset), segment->path);
+            read_all(file.get(), &offset, sizeof(offset), segment->path);
+            seek(file.get(), offset, segment->path);
+            read_all(file.get(), &length, sizeof(length), segment->path);
+            key.resize(length);
+            read_all(file.get(), &key[0], length, segment->path);
+            int order = std::string_view(key).compare(name);
+            if (order == 0) {
+                std::uint64_t value;
+                read_all(file.get(), &value, sizeof(value), segment->path);
+                count += value;
+                break;
+            }
+            if (order < 0) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+    }
+    return count;
+}
+
+void CounterStore::run() {
+    for (;;) {
+        std::shared_ptr<const State> state;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] {
+                return stop_ || !state_->frozen.empty() || state_->segments.size() >= compaction_trigger;
+            });
+            if (stop_ && state_->frozen.empty() && state_->segments.size() < compaction_trigger) {
+                return;
+            }
+            state = state_;
+        }
+
+        // Only this thread changes the segment list, so the new list can be
+        // built from the snapshot and installed afterwards.
+        std::vector<std::shared_ptr<const Segment>> segments;
+        std::vector<std::shared_ptr<const Segment>> obsolete;
+        // Compaction goes first, so a steady stream of flushes cannot make
+        // lookups walk an ever longer list of segments.
+        bool flushed = state->segments.size() < compaction_trigger;
+        try {
+            if (flushed) {
+                const Table& table = *state->frozen.front();
+                Entries entries(table.begin(), table.end());
+                std::sort(entries.begin(), entries.end());
+                segments = state->segments;
+                segments.push_back(write_segment([&](SegmentWriter& out) {
+                    for (const auto& entry : entries) {
+                        out.add(entry.first, entry.second);
+                    }
+                }));
+            } else {
+                segments.push_back(merge_segments(state->segments));
+                obsolete = state->segments;
+            }
+            write_manifest(segments);
+        } catch (const std::exception&) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            failed_ = true;
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto next = std::make_shared<State>(*state_);
+            if (flushed) {
+                next->frozen.erase(next->frozen.begin());
+            }
+            next->segments = segments;
+            state_ = next;
+        }
+        // Removed once lookups still reading them are done.
+        for (const auto& segment : obsolete) {
+            segment->obsolete.store(true);
+        }
+    }
+}
+
+std::shared_ptr<const CounterStore::Segment> CounterStore::open_segment(const std::string& file) const {
+    auto segment = std::make_shared<Segment>(file, (fs::path(dir_) / file).string());
+    File in = open_file(segment->path);
+    std::uint64_t size = fs::file_size(segment->path);
+    char magic[4];
+    read_all(in.get(), magic, sizeof(magic), segment->path);
+    if (std::memcmp(magic, segment_magic, sizeof(magic)) != 0 || size < sizeof(magic) + sizeof(segment->count)) {
+        throw std::runtime_error("corrupt counter segment " + segment->path);
+    }
+    seek(in.get(), size - sizeof(segment->count), segment->path);
+    read_all(in.get(), &segment->count, sizeof(segment->count), segment->path);
+    std::uint64_t index_size = segment->count * sizeof(std::uint64_t);
+    if (segment->count > size / sizeof(std::uint64_t) || size - sizeof(segment->count) - sizeof(magic) < index_size) {
+        throw std::runtime_error("corrupt counter segment " + segment->path);
+    }
+    segment->index_offset = size - sizeof(segment->count) - index_size;
+    return segment;
+}
+
+template <typename Produce>
+std::shared_ptr<const CounterStore::Segment> CounterStore::write_segment(Produce produce) {
+    std::string file = "seg-" + std::to_string(next_segment_++);
+    auto segment = std::make_shared<Segment>(file, (fs::path(dir_) / file).string());
+    replace_file(segment->path, [&](std::FILE* out) {
+        SegmentWriter writer(out);
+        produce(writer);
+        segment->index_offset = writer.finish();
+        segment->count = writer.count();
+    });
+    return segment;
+}
+
+// Streams the segments into one, summing the counts of equal names.
+std::shared_ptr<const CounterStore::Segment>
+CounterStore::merge_segments(const std::vector<std::shared_ptr<const Segment>>& segments) {
+    std::vector<std::unique_ptr<SegmentReader>> readers;
+    for (const auto& segment : segments) {
+        auto reader = std::make_unique<SegmentReader>(segment->path, segment->count);
+        if (reader->next()) {
+            readers.push_back(std::move(reader));
+        }
+    }
+    return write_segment([&](SegmentWriter& out) {
+        std::string name;
+        while (!readers.empty()) {
+            std::size_t first = 0;
+            for (std::size_t i = 1; i < readers.size(); ++i) {
+                if (readers[i]->name() < readers[first]->name()) {
+                    first = i;
+                }
+            }
+            name = readers[first]->name();
+            std::uint64_t total = 0;
+            // Names are unique within a segment, so each reader moves past
+            // name with one step.
+            for (std::size_t i = 0; i < readers.size();) {
+                if (readers[i]->name() == name) {
+                    total += readers[i]->value();
+                    if (!readers[i]->next()) {
+                        readers.erase(readers.begin() + i);
+                        continue;
+                    }
+                }
+                ++i;
+            }
+            out.add(name, total);
+        }
+    });
+}
+
+void CounterStore::write_manifest(const std::vector<std::shared_ptr<const Segment>>& segments) {
+    replace_file(fs::path(dir_) / "MANIFEST", [&](std::FILE* file) {
+        for (const auto& segment : segments) {
+            write_all(file, segment->file.data(), segment->file.size());
+            write_all(file, "\n", 1);
+        }
+    });
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "file_sync.h"
+
+// Small embedded log-structured store of per-name counters.
+//
+// Increments go into an in-memory table. Once it is large enough it is
+// frozen and a background thread writes it out as an immutable, sorted
+// segment file; when segments pile up they are merged into one. Counters
+// are stored as deltas, so writes never read, and a lookup sums the value
+// across the tables and segments. Segments stay on disk: a lookup binary
+// searches each one through its offset index. The MANIFEST file names the
+// live segments and is replaced atomically, so a crash leaves either the
+// old or the new set. Increments not yet flushed are lost on a crash.
+//
+// The store holds an exclusive lock on the directory while it is open, so
+// other processes opening it wait.
+class CounterStore {
+public:
+    explicit CounterStore(const std::string& dir);
+    ~CounterStore();
+
+    CounterStore(const CounterStore&) = delete;
+    CounterStore& operator=(const CounterStore&) = delete;
+
+    // Adds one to the counter of each name. Throws if the background
+    // writer has failed.
+    void add_batch(const std::vector<std::string>& names);
+
+    std::uint64_t lookup(std::string_view name) const;
+
+    // Writes out the counts not yet flushed and stops the background
+    // writer. Throws if any count could not be written; the destructor
+    // drops such errors, so a writer should call this before it is done.
+    // Lookups still work afterwards, and the lock is held until the store
+    // is destroyed.
+    void close();
+
+private:
+    using Table = std::unordered_map<std::string, std::uint64_t>;
+
+    // A segment file: its entries sorted by name, then the offset of each
+    // entry, then the entry count.
+    struct Segment {
+        Segment(std::string file, std::string path);
+        ~Segment();
+
+        std::string file; // name in the store directory
+        std::string path;
+        std::uint64_t count = 0;
+        std::uint64_t index_offset = 0;
+        // Set once compaction has replaced the segment; the file is removed
+        // when the last lookup using it is done.
+        mutable std::atomic<bool> obsolete{false};
+    };
+
+    struct State {
+        std::vector<std::shared_ptr<const Table>> frozen; // oldest first
+        std::vector<std::shared_ptr<const Segment>> segments;
+    };
+
+    static constexpr std::size_t table_limit = 1 << 18;
+    static constexpr std::size_t compaction_trigger = 4;
+
+    void stop();
+    void run();
+    std::shared_ptr<const Segment> open_segment(const std::string& file) const;
+    template <typename Produce>
+    std::shared_ptr<const Segment> write_segment(Produce produce);
+    std::shared_ptr<const Segment> merge_segments(const std::vector<std::shared_ptr<const Segment>>& segments);
+    void write_manifest(const std::vector<std::shared_ptr<const Segment>>& segments);
+
+    std::string dir_;
+    std::unique_ptr<FileLock> lock_;
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    Table table_;
+    std::shared_ptr<const State> state_;
+    std::uint64_t next_segment_ = 1;
+    bool stop_ = false;
+    bool failed_ = false; // the worker could not write; counts are being lost
+    std::thread worker_;
+};
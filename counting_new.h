@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+
+// Replaces the global operator new and delete with versions that count
+// every allocation, for the allocation test and benchmark. Linked in as an
+// object library (hello_counting_new), never into hello itself.
+namespace counting_new {
+
+// Allocations and requested bytes since the program started.
+std::uint64_t allocations();
+std::uint64_t bytes();
+
+} // namespace counting_new
@@ -0,0 +1,99 @@
+#include "cpu_affinity.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace {
+
+[[noreturn]] void invalid(std::string_view text) {
+    throw std::runtime_error("invalid CPU list: " + std::string(text));
+}
+
+unsigned parse_cpu(std::string_view text, std::string_view list) {
+    if (text.empty() || text.size() > 5 || text.find_first_not_of("0123456789") != std::string_view::npos) {
+        invalid(list);
+    }
+    return static_cast<unsigned>(std::stoul(std::string(text)));
+}
+
+} // namespace
+
+CpuSet available_cpus() {
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        throw std::runtime_error("cannot read the CPU affinity of this process");
+    }
+    CpuSet cpus;
+    for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &allowed)) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+#else
+    throw std::runtime_error("CPU affinity is not supported on this platform");
+#endif
+}
+
+CpuSet parse_cpu_list(std::string_view text) {
+    CpuSet allowed = available_cpus();
+    CpuSet cpus;
+    for (std::size_t begin = 0; begin <= text.size();) {
+        std::size_t end = std::min(text.find(',', begin), text.size());
+        std::string_view range = text.substr(begin, end - begin);
+        std::size_t dash = range.find('-');
+        unsigned first = parse_cpu(range.substr(0, dash), text);
+        unsigned last = dash == std::string_view::npos ? first : parse_cpu(range.substr(dash + 1), text);
+        if (last < first) {
+            invalid(text);
+        }
+        for (unsigned cpu = first; cpu <= last; ++cpu) {
+            if (!std::binary_search(allowed.begin(), allowed.end(), cpu)) {
+                throw std::runtime_error("CPU " + std::to_string(cpu) + " is not available to this process");
+            }
+            cpus.push_back(cpu);
+        }
+        begin = end + 1;
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+void pin_current_thread(const CpuSet& cpus) {
+    if (cpus.empty()) {
+        return;
+    }
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (unsigned cpu : cpus) {
+        CPU_SET(cpu, &set);
+    }
+    // On Linux, pid 0 is the calling thread rather than the whole process.
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        throw std::runtime_error("cannot set the CPU affinity of a thread");
+    }
+#else
+    throw std::runtime_error("CPU affinity is not supported on this platform");
+#endif
+}
+
+bool cpu_sets_overlap(const CpuSet& a, const CpuSet& b) {
+    auto i = a.begin();
+    auto j = b.begin();
+    while (i != a.end() && j != b.end()) {
+        if (*i == *j) {
+            return true;
+        }
+        *i < *j ? ++i : ++j;
+    }
+    return false;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+// CPU numbers, sorted and without duplicates. Empty means no pinning.
+using CpuSet = std::vector<unsigned>;
+
+// Parses a list such as "0-3,6". Throws std::runtime_error on malformed
+// lists and on CPUs this process may not run on.
+CpuSet parse_cpu_list(std::string_view text);
+
+// CPUs this process may run on.
+CpuSet available_cpus();
+
+// Restricts the calling thread to cpus; does nothing if cpus is empty.
+// Threads started later by this thread inherit the set.
+void pin_current_thread(const CpuSet& cpus);
+
+// Whether a and b have a CPU in common.
+bool cpu_sets_overlap(const CpuSet& a, const CpuSet& b);
@@ -0,0 +1,83 @@
+#include "cpu_dispatch.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+
+#if defined(HELLO_X86_DISPATCH) && defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace {
+
+CpuLevel detect() {
+#if defined(HELLO_X86_DISPATCH) && defined(__GNUC__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+        return CpuLevel::avx512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2")) {
+        return CpuLevel::avx2;
+    }
+    return CpuLevel::baseline;
+#elif defined(HELLO_X86_DISPATCH) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return CpuLevel::baseline;
+    }
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx) {
+        return CpuLevel::baseline;
+    }
+    // The OS must save the YMM (and for AVX-512 the opmask and ZMM) state.
+    unsigned long long xcr0 = _xgetbv(0);
+    __cpuidex(info, 7, 0);
+    bool avx2 = (info[1] & (1 << 5)) != 0 && (info[1] & (1 << 8)) != 0;
+    bool avx512 = (info[1] & (1 << 16)) != 0 && (info[1] & (1 << 30)) != 0;
+    if (avx512 && (xcr0 & 0xe6) == 0xe6) {
+        return CpuLevel::avx512;
+    }
+    if (avx2 && (xcr0 & 0x6) == 0x6) {
+        return CpuLevel::avx2;
+    }
+    return CpuLevel::baseline;
+#else
+    return CpuLevel::baseline;
+#endif
+}
+
+CpuLevel capped(CpuLevel level) {
+    const char* cap = std::getenv("HELLO_CPU");
+    if (cap == nullptr) {
+        return level;
+    }
+    for (CpuLevel candidate : {CpuLevel::baseline, CpuLevel::avx2, CpuLevel::avx512}) {
+        if (std::strcmp(cap, cpu_level_name(candidate)) == 0) {
+            return candidate < level ? candidate : level;
+        }
+    }
+    return level;
+}
+
+} // namespace
+
+CpuLevel cpu_level() {
+    static const CpuLevel level = capped(detect());
+    return level;
+}
+
+const char* cpu_level_name(CpuLevel level) {
+    switch (level) {
+    case CpuLevel::baseline:
+        return "baseline";
+    case CpuLevel::avx2:
+        return "avx2";
+    case CpuLevel::avx512:
+        return "avx512";
+    }
+    return "baseline";
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+// Runtime selection of SIMD kernels. Builds target the generic baseline;
+// on x86-64 the hot kernels are additionally compiled for newer
+// instruction sets through target attributes, and the best level the host
+// supports is picked once at startup.
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define HELLO_X86_DISPATCH
+#if defined(__GNUC__)
+#define HELLO_TARGET(isa) __attribute__((target(isa)))
+#else
+// MSVC accepts intrinsics of any level without flags.
+#define HELLO_TARGET(isa)
+#endif
+#endif
+
+enum class CpuLevel {
+    baseline, // what the build targets: SSE2 on x86-64
+    avx2,     // AVX2 and BMI2
+    avx512,   // AVX-512 F and BW
+};
+
+// The best level of the host. The HELLO_CPU environment variable
+// ("baseline", "avx2", "avx512") caps it, for benchmarks and for testing
+// the lower levels.
+CpuLevel cpu_level();
+
+const char* cpu_level_name(CpuLevel level);
@@ -0,0 +1,256 @@
+#include "external_sort.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <queue>
+#include <random>
+#include <stdexcept>
+
+#include "name_sort.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr std::size_t min_buffer = 1 << 16;
+constexpr std::size_t max_buffer = 1 << 22;
+
+// Sequential reader of a run file: records of a 32-bit length and the
+// name's bytes, so names may contain any byte, newlines included.
+class RunReader {
+public:
+    RunReader(const std::string& path, std::size_t buffer_size) : buffer_(buffer_size) {
+        file_ = std::fopen(path.c_str(), "rb");
+        if (file_ == nullptr) {
+            throw std::runtime_error("cannot open run file " + path);
+        }
+    }
+
+    ~RunReader() {
+        std::fclose(file_);
+    }
+
+    RunReader(const RunReader&) = delete;
+    RunReader& operator=(const RunReader&) = delete;
+
+    // The returned view stays valid until the next call.
+    bool next(std::string_view& name) {
+        for (;;) {
+            std::size_t available = end_ - begin_;
+            std::size_t needed = sizeof(std::uint32_t);
+            if (available >= needed) {
+                std::uint32_t length;
+                std::memcpy(&length, buffer_.data() + begin_, sizeof(length));
+                needed += length;
+                if (available >= needed) {
+                    name = std::string_view(buffer_.data() + begin_ + sizeof(length), length);
+                    begin_ += needed;
+                    return true;
+                }
+            }
+            if (eof_) {
+                if (available != 0) {
+                    throw std::runtime_error("truncated run file");
+                }
+                return false;
+            }
+            // Move the partial record to the front and refill behind it.
+            std::memmove(buffer_.data(), buffer_.data() + begin_, available);
+            end_ = available;
+            begin_ = 0;
+            if (needed > buffer_.size()) {
+                buffer_.resize(needed);
+            }
+            std::size_t n = std::fread(buffer_.data() + end_, 1, buffer_.size() - end_, file_);
+            end_ += n;
+            if (n == 0) {
+                if (std::ferror(file_)) {
+                    throw std::runtime_error("cannot read run file");
+                }
+                eof_ = true;
+            }
+        }
+    }
+
+private:
+    std::FILE* file_;
+    std::vector<char> buffer_;
+    std::size_t begin_ = 0;
+    std::size_t end_ = 0;
+    bool eof_ = false;
+};
+
+class RunWriter {
+public:
+    RunWriter(const std::string& path, std::size_t buffer_size) : buffer_(buffer_size) {
+        file_ = std::fopen(path.c_str(), "wb");
+        if (file_ == nullptr) {
+            throw std::runtime_error("cannot create run file " + path);
+        }
+        std::setvbuf(file_, buffer_.data(), _IOFBF, buffer_.size());
+    }
+
+    ~RunWriter() {
+        if (file_ != nullptr) {
+            std::fclose(file_);
+        }
+    }
+
+    RunWriter(const RunWriter&) = delete;
+    RunWriter& operator=(const RunWriter&) = delete;
+
+    void write(std::string_view name) {
+        auto length = static_cast<std::uint32_t>(name.size());
+        if (std::fwrite(&length, sizeof(length), 1, file_) != 1 ||
+            std::fwrite(name.data(), 1, name.size(), file_) != name.size()) {
+            throw std::runtime_error("cannot write run file");
+        }
+    }
+
+    void close() {
+        bool ok = std::fclose(file_) == 0;
+        file_ = nullptr;
+        if (!ok) {
+            throw std::runtime_error("cannot write run file");
+        }
+    }
+
+private:
+    std::vector<char> buffer_;
+    std::FILE* file_;
+};
+
+} // namespace
+
+ExternalNameSorter::ExternalNameSorter(std::size_t memory_limit, bool dedup, unsigned threads, std::string temp_dir,
+                                       CpuSet worker_cpus)
+    : memory_limit_(std::max<std::size_t>(memory_limit, 4 * min_buffer)), dedup_(dedup), threads_(threads),
+      worker_cpus_(std::move(worker_cpus)),
+      temp_dir_(temp_dir.empty() ? fs::temp_directory_path().string() : std::move(temp_dir)) {
+    std::random_device random;
+    run_prefix_ = (fs::path(temp_dir_) / ("hello-run-" + std::to_string(random()) + "-")).string();
+}
+
+ExternalNameSorter::~ExternalNameSorter() {
+    for (const auto& run : runs_) {
+        std::error_code ignored;
+        fs::remove(run, ignored);
+    }
+}
+
+void ExternalNameSorter::add(std::string_view name) {
+    // The arena and the refs may each briefly double while growing, and the
+    // sort needs a second copy of the refs; half the limit leaves room.
+    if (arena_.size_bytes() + name.size() + (refs_.size() + 1) * 2 * sizeof(NameRef) > memory_limit_ / 2) {
+        spill();
+    }
+    refs_.push_back(arena_.add(name));
+}
+
+void ExternalNameSorter::sort_chunk() {
+    sort_names(arena_, refs_, threads_, worker_cpus_);
+    if (dedup_) {
+        refs_.erase(std::unique(refs_.begin(), refs_.end(),
+                                [&](NameRef a, NameRef b) { return arena_.view(a) == arena_.view(b); }),
+                    refs_.end());
+    }
+}
+
+void ExternalNameSorter::spill() {
+    if (refs_.empty()) {
+        return;
+    }
+    sort_chunk();
+    std::string path = run_prefix_ + std::to_string(next_run_++);
+    runs_.push_back(path);
+    // Spilling happens at half the memory limit; the write buffer takes a
+    // small share of the rest.
+    RunWriter writer(path, std::min(std::max(memory_limit_ / 16, min_buffer), max_buffer));
+    for (NameRef ref : refs_) {
+        writer.write(arena_.view(ref));
+    }
+    writer.close();
+    arena_ = NameArena();
+    refs_ = std::vector<NameRef>();
+}
+
+void ExternalNameSorter::finish(const std::function<void(std::string_view)>& emit) {
+    if (runs_.empty()) {
+        sort_chunk();
+        for (NameRef ref : refs_) {
+            emit(arena_.view(ref));
+        }
+        return;
+    }
+    spill();
+
+    std::size_t fan_in = std::max<std::size_t>(2, memory_limit_ / 2 / min_buffer);
+    while (runs_.size() > fan_in) {
+        std::vector<std::string> current = runs_;
+        for (std::size_t i = 0; i < current.size(); i += fan_in) {
+            std::vector<std::string> group(current.begin() + i, current.begin() + std::min(current.size(), i + fan_in));
+            merge(group, memory_limit_ / 2 / (group.size() + 1), nullptr);
+        }
+    }
+    std::vector<std::string> last = runs_;
+    merge(last, memory_limit_ / 2 / last.size(), &emit);
+}
+
+// Merges runs into emit, or into a new run file if emit is null. The input
+// runs are removed afterwards.
+std::string ExternalNameSorter::merge(const std::vector<std::string>& runs, std::size_t buffer_size,
+                                      const std::function<void(std::string_view)>* emit) {
+    buffer_size = std::min(std::max(buffer_size, min_buffer), max_buffer);
+    std::vector<std::unique_ptr<RunReader>> readers;
+    std::vector<std::string_view> heads(runs.size());
+    auto later = [&](std::size_t a, std::size_t b) { return heads[b] < heads[a]; };
+    std::priority_queue<std::size_t, std::vector<std::size_t>, decltype(later)> queue(later);
+    for (std::size_t i = 0; i < runs.size(); ++i) {
+        readers.push_back(std::make_unique<RunReader>(runs[i], buffer_size));
+        if (readers[i]->next(heads[i])) {
+            queue.push(i);
+        }
+    }
+
+    std::string output;
+    std::unique_ptr<RunWriter> writer;
+    if (emit == nullptr) {
+        output = run_prefix_ + std::to_string(next_run_++);
+        runs_.push_back(output);
+        writer = std::make_unique<RunWriter>(output, buffer_size);
+    }
+    std::string last;
+    bool first = true;
+    while (!queue.empty()) {
+        std::size_t i = queue.top();
+        queue.pop();
+        if (!dedup_ || first || heads[i] != last) {
+            if (writer) {
+                writer->write(heads[i]);
+            } else {
+                (*emit)(heads[i]);
+            }
+            if (dedup_) {
+                last.assign(heads[i]);
+                first = false;
+            }
+        }
+        if (readers[i]->next(heads[i])) {
+            queue.push(i);
+        }
+    }
+    if (writer) {
+        writer->close();
+    }
+
+    readers.clear();
+    for (const auto& run : runs) {
+        std::error_code ignored;
+        fs::remove(run, ignored);
+        runs_.erase(std::find(runs_.begin(), runs_.end(), run));
+    }
+    return output;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cpu_affinity.h"
+#include "name_arena.h"
+
+// Sorts name lists larger than memory. Names are collected into an arena
+// until it reaches half the memory limit, then sorted (and deduplicated)
+// in memory and spilled to a run file. finish() merges the runs with
+// large sequential reads; if there are too many runs to give each a decent
+// buffer within the limit, groups of them are merged into longer runs
+// first. Run files are removed when the sorter is destroyed.
+class ExternalNameSorter {
+public:
+    ExternalNameSorter(std::size_t memory_limit, bool dedup, unsigned threads, std::string temp_dir,
+                       CpuSet worker_cpus = CpuSet());
+    ~ExternalNameSorter();
+
+    ExternalNameSorter(const ExternalNameSorter&) = delete;
+    ExternalNameSorter& operator=(const ExternalNameSorter&) = delete;
+
+    void add(std::string_view name);
+
+    // Calls emit for every name in sorted order.
+    void finish(const std::function<void(std::string_view)>& emit);
+
+private:
+    void sort_chunk();
+    void spill();
+    std::string merge(const std::vector<std::string>& runs, std::size_t buffer_size,
+                      const std::function<void(std::string_view)>* emit);
+
+    std::size_t memory_limit_;
+    bool dedup_;
+    unsigned threads_;
+    CpuSet worker_cpus_;
+    std::string temp_dir_;
+    std::string run_prefix_;
+    std::size_t next_run_ = 0;
+    NameArena arena_;
+    std::vector<NameRef> refs_;
+    std::vector<std::string> runs_;
+};
@@ -0,0 +1,83 @@
+#include "file_sync.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <io.h>
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+bool sync_file(std::FILE* file) {
+    if (std::fflush(file) != 0) {
+        return false;
+    }
+#if defined(_WIN32)
+    return _commit(_fileno(file)) == 0;
+#elif defined(__APPLE__)
+    return fsync(fileno(file)) == 0;
+#else
+    return fdatasync(fileno(file)) == 0;
+#endif
+}
+
+bool sync_directory(const std::string& dir) {
+#ifdef _WIN32
+    (void)dir;
+    return true;
+#else
+    int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+#endif
+}
+
+#ifdef _WIN32
+FileLock::FileLock(const std::string& path) {
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("cannot open lock file " + path);
+    }
+    OVERLAPPED overlapped = {};
+    if (!LockFileEx(handle, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &overlapped)) {
+        CloseHandle(handle);
+        throw std::runtime_error("cannot lock " + path);
+    }
+    handle_ = handle;
+}
+
+FileLock::~FileLock() {
+    // Closing the handle releases the lock.
+    CloseHandle(static_cast<HANDLE>(handle_));
+}
+#else
+FileLock::FileLock(const std::string& path) {
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("cannot open lock file " + path);
+    }
+    int result;
+    while ((result = flock(fd_, LOCK_EX)) != 0 && errno == EINTR) {
+    }
+    if (result != 0) {
+        close(fd_);
+        throw std::runtime_error("cannot lock " + path);
+    }
+}
+
+FileLock::~FileLock() {
+    // Closing the descriptor releases the lock.
+    close(fd_);
+}
+#endif
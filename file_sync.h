@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+
+// Flushes file and waits until its data has reached the disk.
+bool sync_file(std::FILE* file);
+
+// Waits until the entries of dir, such as a file just renamed into it,
+// have reached the disk. Does nothing where directories cannot be synced.
+bool sync_directory(const std::string& dir);
+
+// Exclusive lock on a file, held for the lifetime of the object; the file
+// is created if needed. Blocks while another process holds the lock.
+class FileLock {
+public:
+    explicit FileLock(const std::string& path);
+    ~FileLock();
+
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+
+private:
+#ifdef _WIN32
+    void* handle_;
+#else
+    int fd_;
+#endif
+};
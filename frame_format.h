@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Binary output framing of `hello --format binary`.
+//
+// The stream is a sequence of batches. Each batch starts with a 12-byte
+// header: the magic "HGF1", the number of records and the size of the body
+// in bytes, both 32-bit little endian. The body holds the records, each a
+// LEB128 varint length followed by that many payload bytes. Consumers can
+// skip or hand off whole batches and never scan payloads for delimiters.
+namespace frame_format {
+
+constexpr char magic[4] = {'H', 'G', 'F', '1'};
+constexpr std::size_t header_size = 12;
+
+inline void put_u32(char* out, std::uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<char>(value >> (8 * i));
+    }
+}
+
+inline std::uint32_t get_u32(const char* in) {
+    std::uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= std::uint32_t(static_cast<unsigned char>(in[i])) << (8 * i);
+    }
+    return value;
+}
+
+inline std::size_t varint_size(std::uint64_t value) {
+    std::size_t size = 1;
+    for (; value >= 0x80; value >>= 7) {
+        ++size;
+    }
+    return size;
+}
+
+inline char* put_varint(char* out, std::uint64_t value) {
+    while (value >= 0x80) {
+        *out++ = static_cast<char>(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = static_cast<char>(value);
+    return out;
+}
+
+} // namespace frame_format
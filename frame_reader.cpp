@@ -0,0 +1,80 @@
+#include "frame_reader.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include "frame_format.h"
+
+namespace {
+
+std::uint64_t get_varint(std::string_view data, std::size_t& position, std::size_t end) {
+    std::uint64_t value = 0;
+    for (unsigned shift = 0; position < end && shift < 64; shift += 7) {
+        unsigned char byte = static_cast<unsigned char>(data[position++]);
+        value |= std::uint64_t(byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            return value;
+        }
+    }
+    throw std::runtime_error("malformed record length in frame stream");
+}
+
+} // namespace
+
+bool FrameParser::next(std::string_view& record) {
+    while (remaining_ == 0) {
+        if (position_ != batch_end_) {
+            throw std::runtime_error("batch size does not match its records");
+        }
+        if (position_ == data_.size()) {
+            return false;
+        }
+        if (data_.size() - position_ < frame_format::header_size ||
+            std::memcmp(data_.data() + position_, frame_format::magic, sizeof(frame_format::magic)) != 0) {
+            throw std::runtime_error("malformed batch header in frame stream");
+        }
+        remaining_ = frame_format::get_u32(data_.data() + position_ + 4);
+        std::size_t size = frame_format::get_u32(data_.data() + position_ + 8);
+        position_ += frame_format::header_size;
+        if (data_.size() - position_ < size) {
+            throw std::runtime_error("truncated batch in frame stream");
+        }
+        batch_end_ = position_ + size;
+    }
+    std::uint64_t length = get_varint(data_, position_, batch_end_);
+    if (batch_end_ - position_ < length) {
+        throw std::runtime_error("record overruns its batch in frame stream");
+    }
+    record = data_.substr(position_, static_cast<std::size_t>(length));
+    position_ += static_cast<std::size_t>(length);
+    --remaining_;
+    return true;
+}
+
+bool FrameReader::next(std::string_view& record) {
+    while (!parser_.next(record)) {
+        if (!read_batch()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FrameReader::read_batch() {
+    char header[frame_format::header_size];
+    std::size_t n = std::fread(header, 1, sizeof(header), file_);
+    if (n == 0 && !std::ferror(file_)) {
+        return false;
+    }
+    if (n != sizeof(header) || std::memcmp(header, frame_format::magic, sizeof(frame_format::magic)) != 0) {
+        throw std::runtime_error("malformed batch header in frame stream");
+    }
+    std::size_t size = frame_format::get_u32(header + 8);
+    batch_.resize(sizeof(header) + size);
+    std::memcpy(batch_.data(), header, sizeof(header));
+    if (std::fread(batch_.data() + sizeof(header), 1, size, file_) != size) {
+        throw std::runtime_error("truncated batch in frame stream");
+    }
+    parser_ = FrameParser(std::string_view(batch_.data(), batch_.size()));
+    return true;
+}
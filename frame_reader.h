@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+#include <vector>
+
+// Reader for the binary framing written by `hello --format binary` (see
+// frame_format.h).
+
+// Iterates the records of a complete stream held in memory.
+class FrameParser {
+public:
+    explicit FrameParser(std::string_view data) : data_(data) {}
+
+    // Returns false at the end of the data. Throws std::runtime_error on a
+    // malformed stream.
+    bool next(std::string_view& record);
+
+private:
+    std::string_view data_;
+    std::size_t position_ = 0;
+    std::size_t batch_end_ = 0;
+    std::uint32_t remaining_ = 0;
+};
+
+// Reads a stream batch by batch from a FILE*; only one batch is held in
+// memory at a time.
+class FrameReader {
+public:
+    explicit FrameReader(std::FILE* file) : file_(file) {}
+
+    // The record stays valid until the next call.
+    bool next(std::string_view& record);
+
+private:
+    bool read_batch();
+
+    std::FILE* file_;
+    std::vector<char> batch_;
+    FrameParser parser_{std::string_view()};
+};
@@ -0,0 +1,55 @@
+#include "frame_writer.h"
+
+#include <cstring>
+
+#include "frame_format.h"
+
+FrameWriter::FrameWriter(OutputBuffer& out, std::size_t batch_size)
+    : out_(out), batch_size_(batch_size), body_(batch_size) {}
+
+FrameWriter::~FrameWriter() {
+    try {
+        flush();
+    } catch (...) {
+    }
+}
+
+char* FrameWriter::begin_record(std::size_t max_size) {
+    std::size_t prefix = frame_format::varint_size(max_size);
+    std::size_t needed = prefix + max_size;
+    if (size_ != 0 && size_ + needed > batch_size_) {
+        flush();
+    }
+    if (body_.size() < size_ + needed) {
+        body_.resize(size_ + needed);
+    }
+    // The payload goes after room for the varint of max_size and is only
+    // moved down if its actual length has a shorter varint.
+    record_ = body_.data() + size_ + prefix;
+    return record_;
+}
+
+void FrameWriter::end_record(const char* end) {
+    std::size_t length = end - record_;
+    char* header = body_.data() + size_;
+    char* payload = frame_format::put_varint(header, length);
+    if (payload != record_) {
+        std::memmove(payload, record_, length);
+    }
+    size_ = payload + length - body_.data();
+    ++count_;
+}
+
+void FrameWriter::flush() {
+    if (count_ == 0) {
+        return;
+    }
+    char* header = out_.reserve(frame_format::header_size);
+    std::memcpy(header, frame_format::magic, sizeof(frame_format::magic));
+    frame_format::put_u32(header + 4, count_);
+    frame_format::put_u32(header + 8, static_cast<std::uint32_t>(size_));
+    out_.commit(frame_format::header_size);
+    out_.append(std::string_view(body_.data(), size_));
+    size_ = 0;
+    count_ = 0;
+}
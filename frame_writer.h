@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "output_buffer.h"
+
+// Collects records into batches of the binary framing (see frame_format.h)
+// and writes each full batch to an OutputBuffer.
+class FrameWriter {
+public:
+    explicit FrameWriter(OutputBuffer& out, std::size_t batch_size = 1 << 16);
+    ~FrameWriter();
+
+    FrameWriter(const FrameWriter&) = delete;
+    FrameWriter& operator=(const FrameWriter&) = delete;
+
+    // Space for a record of up to max_size bytes; end_record() takes the
+    // end of what was written.
+    char* begin_record(std::size_t max_size);
+    void end_record(const char* end);
+
+    void flush();
+
+private:
+    OutputBuffer& out_;
+    std::size_t batch_size_;
+    std::vector<char> body_;
+    std::size_t size_ = 0;
+    std::uint32_t count_ = 0;
+    char* record_ = nullptr;
+};
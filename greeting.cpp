@@ -0,0 +1,48 @@
+#include "greeting.h"
+
+#include <cstring>
+
+char* write_greeting(char* out, std::string_view word, std::string_view name) {
+    std::memcpy(out, word.data(), word.size());
+    out += word.size();
+    if (!name.empty()) {
+        out[0] = ',';
+        out[1] = ' ';
+        std::memcpy(out + 2, name.data(), name.size());
+        out += 2 + name.size();
+    }
+    return out;
+}
+
+char* write_greeting(char* out, std::string_view name) {
+    std::memcpy(out, greeting_word.data(), greeting_word.size());
+    out += greeting_word.size();
+    if (!name.empty()) {
+        out[0] = ',';
+        out[1] = ' ';
+        std::memcpy(out + 2, name.data(), name.size());
+        out += 2 + name.size();
+    }
+    return out;
+}
+
+void append_greeting(std::string& out, std::string_view name) {
+    std::size_t size = out.size();
+    out.resize(size + greeting_size(name));
+    write_greeting(&out[size], name);
+}
+
+void greet_many(const std::string_view* names, std::size_t count, GreetingBatch& out) {
+    out.offsets.resize(count + 1);
+    std::size_t size = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        out.offsets[i] = size;
+        size += greeting_size(names[i]);
+    }
+    out.offsets[count] = size;
+    out.text.resize(size);
+    char* p = &out.text[0];
+    for (std::size_t i = 0; i < count; ++i) {
+        p = write_greeting(p, names[i]);
+    }
+}
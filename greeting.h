@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Greeting formatting shared by the hello binary and library callers.
+
+constexpr std::string_view greeting_word = "Hello";
+
+// Size of the greeting for name, without a trailing newline. An empty
+// name gives the plain greeting.
+inline std::size_t greeting_size(std::string_view word, std::string_view name) {
+    return name.empty() ? word.size() : word.size() + 2 + name.size();
+}
+
+inline std::size_t greeting_size(std::string_view name) {
+    return greeting_size(greeting_word, name);
+}
+
+// Writes "<word>, <name>" to out, which must have room for
+// greeting_size(word, name) bytes. Returns the end of the written greeting.
+char* write_greeting(char* out, std::string_view word, std::string_view name);
+
+// write_greeting() with greeting_word, which is copied as a constant.
+char* write_greeting(char* out, std::string_view name);
+
+void append_greeting(std::string& out, std::string_view name);
+
+// Greetings for a batch of names, stored back to back in one buffer.
+// Greeting i is text[offsets[i], offsets[i + 1]).
+struct GreetingBatch {
+    std::string text;
+    std::vector<std::size_t> offsets;
+
+    std::size_t size() const {
+        return offsets.empty() ? 0 : offsets.size() - 1;
+    }
+
+    std::string_view operator[](std::size_t i) const {
+        return std::string_view(text.data() + offsets[i], offsets[i + 1] - offsets[i]);
+    }
+};
+
+// Replaces the contents of out with the greetings for names[0, count).
+// The buffer is sized once for the whole batch, so a batch costs one call
+// and at most one allocation instead of one of each per name.
+void greet_many(const std::string_view* names, std::size_t count, GreetingBatch& out);
+
+inline void greet_many(const std::vector<std::string_view>& names, GreetingBatch& out) {
+    greet_many(names.data(), names.size(), out);
+}
@@ -0,0 +1,152 @@
+#include "greeting_jobs.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+
+#include "utf8.h"
+
+namespace {
+
+struct BuiltinWord {
+    std::string_view locale;
+    std::string_view word;
+};
+
+// Non-ASCII words are spelled out as UTF-8 bytes so the source encoding
+// does not matter.
+constexpr BuiltinWord builtin_words[] = {
+    {"da", "Hej"},
+    {"de", "Hallo"},
+    {"es", "Hola"},
+    {"fi", "Hei"},
+    {"fr", "Bonjour"},
+    {"it", "Ciao"},
+    {"nl", "Hallo"},
+    {"no", "Hei"},
+    {"pl", "Cze\xc5\x9b\xc4\x87"},
+    {"pt", "Ol\xc3\xa1"},
+    {"sv", "Hej"},
+};
+
+std::string lower_ascii(std::string_view s) {
+    std::string lower(s);
+    for (char& c : lower) {
+        if (c >= 'A' && c <= 'Z') {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+    }
+    return lower;
+}
+
+} // namespace
+
+GreetingCatalog::GreetingCatalog() {
+    words_.push_back(greeting_word);
+    ids_["en"] = 0;
+    for (const BuiltinWord& builtin : builtin_words) {
+        add(builtin.locale, builtin.word);
+    }
+}
+
+GreetingCatalog GreetingCatalog::load(const std::string& path) {
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> file(std::fopen(path.c_str(), "rb"), std::fclose);
+    if (!file) {
+        throw std::runtime_error("cannot open catalog " + path);
+    }
+    std::string text;
+    char buffer[1 << 12];
+    for (std::size_t n; (n = std::fread(buffer, 1, sizeof(buffer), file.get())) > 0;) {
+        text.append(buffer, n);
+    }
+    if (std::ferror(file.get())) {
+        throw std::runtime_error("cannot read catalog " + path);
+    }
+    if (!validate_utf8(text.data(), text.size())) {
+        throw std::runtime_error("catalog " + path + " is not valid UTF-8");
+    }
+
+    GreetingCatalog catalog;
+    std::size_t number = 0;
+    for (std::size_t begin = 0; begin < text.size();) {
+        std::size_t end = std::min(text.find('\n', begin), text.size());
+        std::string_view line(text.data() + begin, end - begin);
+        begin = end + 1;
+        ++number;
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::size_t tab = line.find('\t');
+        if (tab == 0 || tab == std::string_view::npos || tab + 1 == line.size()) {
+            throw std::runtime_error("catalog " + path + " line " + std::to_string(number) +
+                                     ": expected a locale, a tab and a word");
+        }
+        std::string_view word = line.substr(tab + 1);
+        if (word.size() > max_word_size || word.find('\0') != std::string_view::npos) {
+            throw std::runtime_error("catalog " + path + " line " + std::to_string(number) + ": invalid word");
+        }
+        catalog.add(line.substr(0, tab), word);
+    }
+    return catalog;
+}
+
+std::uint32_t GreetingCatalog::add(std::string_view locale, std::string_view word) {
+    std::uint32_t id = static_cast<std::uint32_t>(words_.size());
+    words_.push_back(word);
+    ids_[lower_ascii(locale)] = id;
+    return id;
+}
+
+std::uint32_t GreetingCatalog::find(std::string_view locale) const {
+    std::string key = lower_ascii(locale);
+    for (;;) {
+        auto it = ids_.find(key);
+        if (it != ids_.end()) {
+            return it->second;
+        }
+        std::size_t subtag = key.find_last_of("-_");
+        if (subtag == std::string::npos) {
+            return 0;
+        }
+        key.resize(subtag);
+    }
+}
+
+void greet_jobs(const GreetingJobs& jobs, const GreetingCatalog& catalog, GreetingBatch& out) {
+    std::size_t count = jobs.size();
+    out.offsets.resize(count + 1);
+    std::size_t size = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        out.offsets[i] = size;
+        size += greeting_size(catalog.word(jobs.templates[i]), jobs.names[i]);
+    }
+    out.offsets[count] = size;
+    out.text.resize(size);
+    char* p = &out.text[0];
+    for (std::size_t i = 0; i < count; ++i) {
+        p = write_greeting(p, catalog.word(jobs.templates[i]), jobs.names[i]);
+    }
+}
+
+std::size_t greeting_lines_size(const GreetingJobs& jobs, const GreetingCatalog& catalog) {
+    std::size_t size = 0;
+    for (std::size_t i = 0; i < jobs.size(); ++i) {
+        size += greeting_size(catalog.word(jobs.templates[i]), jobs.names[i]) + 1;
+    }
+    return size;
+}
+
+// Template 0 is greeting_word, which write_greeting() copies as a
+// constant.
+char* greet_jobs(const GreetingJobs& jobs, const GreetingCatalog& catalog, char* out) {
+    for (std::size_t i = 0; i < jobs.size(); ++i) {
+        std::uint32_t id = jobs.templates[i];
+        out = id == 0 ? write_greeting(out, jobs.names[i]) : write_greeting(out, catalog.word(id), jobs.names[i]);
+        *out++ = '\n';
+    }
+    return out;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "greeting.h"
+
+// Strings stored back to back in one byte blob: string i is
+// bytes[offsets[i], offsets[i + 1]).
+class StringColumn {
+public:
+    StringColumn() : offsets_(1, 0) {}
+
+    void push_back(std::string_view s) {
+        std::size_t end = offsets_.back() + s.size();
+        if (end > bytes_.size()) {
+            bytes_.resize(std::max(end, 2 * bytes_.size()));
+        }
+        std::memcpy(bytes_.data() + offsets_.back(), s.data(), s.size());
+        offsets_.push_back(end);
+    }
+
+    std::size_t size() const {
+        return offsets_.size() - 1;
+    }
+
+    std::string_view operator[](std::size_t i) const {
+        return std::string_view(bytes_.data() + offsets_[i], offsets_[i + 1] - offsets_[i]);
+    }
+
+    void clear() {
+        offsets_.resize(1);
+    }
+
+private:
+    std::vector<char> bytes_;
+    std::vector<std::size_t> offsets_;
+};
+
+// Greeting words by locale. A template ID is an index into the words;
+// template 0 is greeting_word, used for unknown locales. "de-AT" falls
+// back to "de"; locales are compared without regard to ASCII case.
+class GreetingCatalog {
+public:
+    static constexpr std::size_t max_word_size = 255;
+
+    // The built-in words.
+    GreetingCatalog();
+
+    // The built-in words plus those of a catalog file: lines of a locale,
+    // a tab and its word. Empty lines and lines starting with '#' are
+    // skipped. Throws std::runtime_error on errors.
+    static GreetingCatalog load(const std::string& path);
+
+    // Returns the template ID of the new word. A locale that is already
+    // present now maps to it.
+    std::uint32_t add(std::string_view locale, std::string_view word);
+    std::uint32_t find(std::string_view locale) const;
+
+    std::string_view word(std::uint32_t id) const {
+        return words_[id];
+    }
+
+    std::size_t size() const {
+        return words_.size();
+    }
+
+private:
+    StringColumn words_;
+    std::unordered_map<std::string, std::uint32_t> ids_;
+};
+
+// A batch of greeting jobs kept as columns instead of an array of records
+// with string members, so rendering walks each column front to back.
+struct GreetingJobs {
+    StringColumn names;
+    StringColumn locales;
+    std::vector<std::uint32_t> templates;
+
+    void add(std::string_view name, std::string_view locale, const GreetingCatalog& catalog) {
+        names.push_back(name);
+        locales.push_back(locale);
+        templates.push_back(locale.empty() ? 0 : catalog.find(locale));
+    }
+
+    std::size_t size() const {
+        return templates.size();
+    }
+
+    void clear() {
+        names.clear();
+        locales.clear();
+        templates.clear();
+    }
+};
+
+// Like greet_many(), with each job's word taken from the catalog.
+void greet_jobs(const GreetingJobs& jobs, const GreetingCatalog& catalog, GreetingBatch& out);
+
+// The greetings of jobs as text lines, written straight to out, which has
+// room for greeting_lines_size() bytes. Returns the end of the last line.
+std::size_t greeting_lines_size(const GreetingJobs& jobs, const GreetingCatalog& catalog);
+char* greet_jobs(const GreetingJobs& jobs, const GreetingCatalog& catalog, char* out);
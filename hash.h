@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// Fast non-cryptographic 64-bit hash for names. Reads eight bytes at a time
+// and finishes with a full avalanche, so both the low bits (bucket) and the
+// high bits (tag) are usable.
+inline std::uint64_t hash_mix(std::uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+inline std::uint64_t hash_bytes(std::string_view s) {
+    constexpr std::uint64_t k = 0x9e3779b97f4a7c15ull;
+    std::uint64_t h = s.size() * k;
+    const char* p = s.data();
+    std::size_t n = s.size();
+    for (; n >= 8; n -= 8, p += 8) {
+        std::uint64_t chunk;
+        std::memcpy(&chunk, p, 8);
+        h = (h ^ chunk) * k;
+        h ^= h >> 29;
+    }
+    if (n != 0) {
+        std::uint64_t chunk = 0;
+        std::memcpy(&chunk, p, n);
+        h = (h ^ chunk) * k;
+    }
+    return hash_mix(h);
+}
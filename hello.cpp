@@ -1,6 +1,527 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
 
-int main() {
-    std::cout << "Hello" << std::endl;
+#include "ascii_counter.h"
+#include "audit_log.h"
+#include "counter_store.h"
+#include "cpu_affinity.h"
+#include "greeting.h"
+#include "name_stats.h"
+#include "names_mode.h"
+#include "output_buffer.h"
+#include "output_cache.h"
+#include "scheduler.h"
+#include "shm_ring.h"
+#ifdef HELLO_HAVE_SHM
+#include "shm_ring_writer.h"
+#endif
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+#ifdef HELLO_HAVE_SHM_CHANNEL
+#include <chrono>
+#include <csignal>
+
+#include "shm_channel.h"
+#endif
+
+namespace {
+
+struct Options {
+    std::uint64_t count = 1;
+    bool numbered = false;
+    std::string schedule_path;
+    NamesOptions names;
+    std::string greeted_query;
+    std::string cache_dir;
+    std::string audit_path;
+    std::string shm_name;
+    std::uint64_t shm_slots = 256;
+    std::string serve_shm_name;
+    bool busy_poll = false;
+    // CPUs for the thread that writes the output, or that serves with
+    // --serve-shm; the worker CPUs are in names.
+    CpuSet writer_cpus;
+    CpuSet server_cpus;
+    // Arguments that determine the output, used as the cache key.
+    std::string key;
+};
+
+// Byte count with an optional K, M or G suffix.
+std::uint64_t parse_size(const char* text) {
+    // strtoull would skip blanks and take a sign, so " -1" would wrap; a
+    // leading digit also keeps a bare suffix such as "K" out.
+    if (!std::isdigit(static_cast<unsigned char>(text[0]))) {
+        throw std::runtime_error(std::string("invalid size: ") + text);
+    }
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long value = std::strtoull(text, &end, 10);
+    int shift = 0;
+    switch (*end) {
+    case 'K':
+    case 'k':
+        shift = 10;
+        break;
+    case 'M':
+    case 'm':
+        shift = 20;
+        break;
+    case 'G':
+    case 'g':
+        shift = 30;
+        break;
+    default:
+        break;
+    }
+    if (end[shift != 0 ? 1 : 0] != '\0') {
+        throw std::runtime_error(std::string("invalid size: ") + text);
+    }
+    if (errno == ERANGE || value > (~0ull >> shift)) {
+        throw std::runtime_error(std::string("size out of range: ") + text);
+    }
+    return value << shift;
+}
+
+std::uint64_t parse_count(const char* text) {
+    if (!std::isdigit(static_cast<unsigned char>(text[0]))) {
+        throw std::runtime_error(std::string("invalid count: ") + text);
+    }
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long value = std::strtoull(text, &end, 10);
+    if (*end != '\0') {
+        throw std::runtime_error(std::string("invalid count: ") + text);
+    }
+    if (errno == ERANGE) {
+        throw std::runtime_error(std::string("count out of range: ") + text);
+    }
+    return value;
+}
+
+Options parse_options(int argc, char* argv[]) {
+    Options options;
+    options.names.threads = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 1; i < argc; ++i) {
+        int first = i;
+        std::string_view arg = argv[i];
+        if (arg == "--cache-dir" && i + 1 < argc) {
+            options.cache_dir = argv[++i];
+            continue;
+        }
+        if (arg == "--counts-db" && i + 1 < argc) {
+            options.names.counts_db = argv[++i];
+            continue;
+        }
+        if (arg == "--memory-limit" && i + 1 < argc) {
+            options.names.memory_limit = parse_size(argv[++i]);
+            continue;
+        }
+        if (arg == "--temp-dir" && i + 1 < argc) {
+            options.names.temp_dir = argv[++i];
+            continue;
+        }
+        if (arg == "--stats") {
+            options.names.stats = true;
+            continue;
+        }
+        if (arg == "--top" && i + 1 < argc) {
+            options.names.top_k = static_cast<std::size_t>(parse_count(argv[++i]));
+            continue;
+        }
+        if (arg == "--threads" && i + 1 < argc) {
+            options.names.threads = static_cast<unsigned>(std::max<std::uint64_t>(1, parse_count(argv[++i])));
+            continue;
+        }
+        if (arg == "--worker-cpus" && i + 1 < argc) {
+            options.names.worker_cpus = parse_cpu_list(argv[++i]);
+            continue;
+        }
+        if (arg == "--writer-cpus" && i + 1 < argc) {
+            options.writer_cpus = parse_cpu_list(argv[++i]);
+            continue;
+        }
+        if (arg == "--server-cpus" && i + 1 < argc) {
+            options.server_cpus = parse_cpu_list(argv[++i]);
+            continue;
+        }
+        if (arg == "--greeted" && i + 1 < argc) {
+            options.greeted_query = argv[++i];
+            continue;
+        }
+        if (arg == "--audit-log" && i + 1 < argc) {
+            options.audit_path = argv[++i];
+            continue;
+        }
+        if (arg == "--shm" && i + 1 < argc) {
+            options.shm_name = argv[++i];
+            continue;
+        }
+        if (arg == "--serve-shm" && i + 1 < argc) {
+            options.serve_shm_name = argv[++i];
+            continue;
+        }
+        if (arg == "--busy-poll") {
+            options.busy_poll = true;
+            continue;
+        }
+        if (arg == "--shm-slots" && i + 1 < argc) {
+            options.shm_slots = std::max<std::uint64_t>(1, parse_count(argv[++i]));
+            if (options.shm_slots > shm_ring::max_slots) {
+                throw std::runtime_error("--shm-slots must be at most " + std::to_string(shm_ring::max_slots));
+            }
+            continue;
+        }
+        if (arg == "--count" && i + 1 < argc) {
+            options.count = parse_count(argv[++i]);
+        } else if (arg == "--numbered") {
+            options.numbered = true;
+        } else if (arg == "--dedup") {
+            options.names.dedup = true;
+        } else if (arg == "--sort") {
+            options.names.sort = true;
+        } else if (arg == "--schedule" && i + 1 < argc) {
+            options.schedule_path = argv[++i];
+        } else if (arg == "--format" && i + 1 < argc) {
+            std::string_view format = argv[++i];
+            if (format == "text") {
+                options.names.format = OutputFormat::text;
+            } else if (format == "jsonl") {
+                options.names.format = OutputFormat::jsonl;
+            } else if (format == "binary") {
+                options.names.format = OutputFormat::binary;
+            } else {
+                throw std::runtime_error("unknown format: " + std::string(format));
+            }
+        } else if (arg == "--input-format" && i + 1 < argc) {
+            std::string_view format = argv[++i];
+            if (format == "text") {
+                options.names.input_format = InputFormat::text;
+            } else if (format == "jsonl") {
+                options.names.input_format = InputFormat::jsonl;
+            } else {
+                throw std::runtime_error("unknown input format: " + std::string(format));
+            }
+        } else if (arg == "--names" && i + 1 < argc) {
+            options.names.path = argv[++i];
+        } else if (arg == "--catalog" && i + 1 < argc) {
+            options.names.catalog = argv[++i];
+        } else {
+            throw std::runtime_error("unknown option: " + std::string(arg));
+        }
+        for (int j = first; j <= i; ++j) {
+            options.key.append(argv[j]).push_back('\0');
+        }
+    }
+    return options;
+}
+
+// Pins the main thread, which writes the output or serves requests, and
+// keeps the worker threads off its CPUs: without --worker-cpus they get
+// every other CPU.
+void place_threads(Options& options) {
+    bool serving = !options.serve_shm_name.empty();
+    if (!options.server_cpus.empty() && !serving) {
+        throw std::runtime_error("--server-cpus needs --serve-shm");
+    }
+    if (options.busy_poll && !serving) {
+        throw std::runtime_error("--busy-poll needs --serve-shm");
+    }
+    if (!options.writer_cpus.empty() && serving) {
+        throw std::runtime_error("--writer-cpus cannot be combined with --serve-shm; use --server-cpus");
+    }
+    const CpuSet& main_cpus = serving ? options.server_cpus : options.writer_cpus;
+    if (main_cpus.empty()) {
+        return;
+    }
+    CpuSet& workers = options.names.worker_cpus;
+    if (workers.empty()) {
+        for (unsigned cpu : available_cpus()) {
+            if (!std::binary_search(main_cpus.begin(), main_cpus.end(), cpu)) {
+                workers.push_back(cpu);
+            }
+        }
+        // Workers: the catalog reloader when serving, parse and sort
+        // threads otherwise.
+        bool has_workers = serving ? !options.names.catalog.empty() : options.names.threads > 1;
+        if (workers.empty() && has_workers) {
+            throw std::runtime_error("no CPU is left for the worker threads");
+        }
+    } else if (cpu_sets_overlap(workers, main_cpus)) {
+        throw std::runtime_error(serving ? "--worker-cpus and --server-cpus overlap"
+                                         : "--worker-cpus and --writer-cpus overlap");
+    }
+    pin_current_thread(main_cpus);
+}
+
+// Copies of the same line are written as whole blocks of repeated lines.
+void emit_plain(OutputBuffer& out, std::uint64_t count) {
+    std::string line = std::string(greeting_word) + '\n';
+    std::string block;
+    std::uint64_t per_block = std::max<std::uint64_t>(1, (1 << 15) / line.size());
+    for (std::uint64_t i = 0; i < per_block && i < count; ++i) {
+        block += line;
+    }
+    for (; count >= per_block; count -= per_block) {
+        out.append(block);
+    }
+    out.append(std::string_view(block.data(), count * line.size()));
+}
+
+// "Hello 1", "Hello 2", ...: the number is kept as ASCII digits and
+// incremented in place, so no integer formatting happens per line.
+void emit_numbered(OutputBuffer& out, std::uint64_t count) {
+    AsciiCounter counter(1);
+    std::size_t max_line = greeting_word.size() + 1 + 20 + 1;
+    for (std::uint64_t i = 0; i < count; ++i) {
+        std::string_view digits = counter.view();
+        char* p = out.reserve(max_line);
+        std::memcpy(p, greeting_word.data(), greeting_word.size());
+        p[greeting_word.size()] = ' ';
+        std::memcpy(p + greeting_word.size() + 1, digits.data(), digits.size());
+        p[greeting_word.size() + 1 + digits.size()] = '\n';
+        out.commit(greeting_word.size() + digits.size() + 2);
+        counter.increment();
+    }
+}
+
+void render(const Options& options, OutputBuffer& out) {
+    if (options.names.format != OutputFormat::text && options.names.path.empty()) {
+        throw std::runtime_error("--format needs --names");
+    }
+    if (!options.names.catalog.empty() && options.names.path.empty()) {
+        throw std::runtime_error("--catalog needs --names or --serve-shm");
+    }
+    if (!options.names.path.empty()) {
+        emit_names(options.names, out);
+    } else if (!options.schedule_path.empty()) {
+        run_schedule(read_schedule(options.schedule_path), out);
+    } else if (options.numbered) {
+        emit_numbered(out, options.count);
+    } else {
+        emit_plain(out, options.count);
+    }
+    out.flush();
+}
+
+// Adds what identifies the current contents of an input file to key, so a
+// replaced or edited file misses the cache: size and modification time,
+// plus device and inode where there are such. stdin has no identity and is
+// refused.
+void append_file_identity(std::string& key, const std::string& path) {
+    if (path == "-") {
+        throw std::runtime_error("--cache-dir cannot cache input read from stdin");
+    }
+    namespace fs = std::filesystem;
+    std::error_code error;
+    auto size = fs::file_size(path, error);
+    auto modified = fs::last_write_time(path, error);
+    if (error) {
+        throw std::runtime_error("cannot open " + path);
+    }
+    key.append(std::to_string(size)).push_back('\0');
+    key.append(std::to_string(modified.time_since_epoch().count())).push_back('\0');
+#ifndef _WIN32
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        throw std::runtime_error("cannot open " + path);
+    }
+    key.append(std::to_string(st.st_dev)).push_back('\0');
+    key.append(std::to_string(st.st_ino)).push_back('\0');
+#endif
+}
+
+// Renders into the cache on a miss and then serves the cached copy, so
+// every invocation takes the same streaming path.
+void render_cached(const Options& options) {
+    std::string key = options.key;
+    for (const std::string* input : {&options.names.path, &options.names.catalog}) {
+        if (!input->empty()) {
+            append_file_identity(key, *input);
+        }
+    }
+    OutputCache cache(options.cache_dir, key);
+    if (cache.serve(stdout)) {
+        return;
+    }
+    {
+        OutputBuffer out(cache.begin_store());
+        render(options, out);
+    }
+    cache.commit();
+    if (!cache.serve(stdout)) {
+        throw std::runtime_error("cache entry vanished");
+    }
+}
+
+void render_shm(const Options& options, Tap* tap) {
+#ifdef HELLO_HAVE_SHM
+    constexpr std::size_t slot_size = 1 << 16;
+    ShmRingWriter ring(options.shm_name, options.shm_slots, slot_size);
+    OutputBuffer out(ring, slot_size);
+    out.set_tap(tap);
+    render(options, out);
+#else
+    (void)options;
+    (void)tap;
+    throw std::runtime_error("--shm is not supported on this platform");
+#endif
+}
+
+#ifdef HELLO_HAVE_SHM_CHANNEL
+std::atomic<bool> stop_requested{false};
+
+std::atomic<bool> reload_requested{false};
+
+extern "C" void request_stop(int) {
+    stop_requested.store(true);
+}
+
+extern "C" void request_reload(int) {
+    reload_requested.store(true);
+}
+
+// Rereads the catalog on SIGHUP until the server stops. The new catalog is
+// built on this thread and swapped in while the server keeps answering.
+void reload_catalog(ShmGreetingServer& server, const std::string& path) {
+    while (!stop_requested.load()) {
+        if (reload_requested.exchange(false)) {
+            try {
+                server.set_catalog(std::make_unique<GreetingCatalog>(GreetingCatalog::load(path)));
+            } catch (const std::exception& e) {
+                std::cerr << "hello: keeping the previous catalog: " << e.what() << std::endl;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+}
+#endif
+
+void serve_shm(const Options& options) {
+#ifdef HELLO_HAVE_SHM_CHANNEL
+    std::signal(SIGINT, request_stop);
+    std::signal(SIGTERM, request_stop);
+    const std::string& catalog = options.names.catalog;
+    ShmGreetingServer server(options.serve_shm_name,
+                             catalog.empty() ? nullptr : std::make_unique<GreetingCatalog>(GreetingCatalog::load(catalog)));
+    std::unique_ptr<NameStats> stats;
+    if (options.names.stats) {
+        stats = std::make_unique<NameStats>(options.names.top_k);
+        server.on_greeted([&stats](std::string_view name, std::size_t bytes) { stats->add(name, bytes); });
+    }
+    if (catalog.empty()) {
+        server.run(stop_requested, options.busy_poll);
+    } else {
+        std::signal(SIGHUP, request_reload);
+        // Like the other workers, a reloader that cannot be pinned fails the
+        // run: it stops the server and its error is rethrown here.
+        std::exception_ptr reloader_error;
+        std::thread reloader([&server, &catalog, &options, &reloader_error] {
+            try {
+                pin_current_thread(options.names.worker_cpus);
+            } catch (...) {
+                reloader_error = std::current_exception();
+                stop_requested.store(true);
+                return;
+            }
+            reload_catalog(server, catalog);
+        });
+        try {
+            server.run(stop_requested, options.busy_poll);
+        } catch (...) {
+            stop_requested.store(true);
+            reloader.join();
+            throw;
+        }
+        stop_requested.store(true);
+        reloader.join();
+        if (reloader_error) {
+            std::rethrow_exception(reloader_error);
+        }
+    }
+    if (stats) {
+        stats->report(std::cerr);
+    }
+#else
+    (void)options;
+    throw std::runtime_error("--serve-shm is not supported on this platform");
+#endif
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        Options options = parse_options(argc, argv);
+        place_threads(options);
+        // These modes do not write to stdout, so there is nothing to cache.
+        if (!options.cache_dir.empty() &&
+            (!options.shm_name.empty() || !options.serve_shm_name.empty() || !options.greeted_query.empty())) {
+            throw std::runtime_error("--cache-dir cannot be combined with --shm, --serve-shm or --greeted");
+        }
+        // A cache hit skips rendering: counts and stats would be dropped.
+        if (!options.cache_dir.empty() && (!options.names.counts_db.empty() || options.names.stats)) {
+            throw std::runtime_error("--counts-db and --stats cannot be combined with --cache-dir");
+        }
+        // Cached output is written all at once, without the schedule's timing.
+        if (!options.cache_dir.empty() && !options.schedule_path.empty()) {
+            throw std::runtime_error("--schedule cannot be combined with --cache-dir");
+        }
+        // The ring splits its output at newlines, which can fall inside a
+        // frame, so a lapped reader would resync mid-frame.
+        if (!options.shm_name.empty() && options.names.format == OutputFormat::binary) {
+            throw std::runtime_error("--shm cannot be combined with --format binary");
+        }
+        std::unique_ptr<AuditLog> audit;
+        if (!options.audit_path.empty()) {
+            // Cache hits and served requests bypass rendering, so they
+            // would escape the log.
+            if (!options.cache_dir.empty() || !options.serve_shm_name.empty()) {
+                throw std::runtime_error("--audit-log cannot be combined with --cache-dir or --serve-shm");
+            }
+            // The log is kept in lines; framed records would be split on
+            // any newline byte inside them.
+            if (options.names.format == OutputFormat::binary) {
+                throw std::runtime_error("--audit-log cannot be combined with --format binary");
+            }
+            audit = std::make_unique<AuditLog>(options.audit_path);
+        }
+        if (!options.greeted_query.empty()) {
+            if (options.names.counts_db.empty()) {
+                throw std::runtime_error("--greeted needs --counts-db");
+            }
+            std::cout << CounterStore(options.names.counts_db).lookup(options.greeted_query) << '\n';
+        } else if (!options.serve_shm_name.empty()) {
+            serve_shm(options);
+        } else if (!options.shm_name.empty()) {
+            render_shm(options, audit.get());
+        } else if (!options.cache_dir.empty()) {
+            render_cached(options);
+        } else {
+            OutputBuffer out(stdout);
+            out.set_tap(audit.get());
+            render(options, out);
+        }
+        if (audit) {
+            audit->sync();
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "hello: " << e.what() << std::endl;
+        return 1;
+    }
     return 0;
 }
@@ -0,0 +1,177 @@
+#include "json_escape.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include "cpu_dispatch.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HELLO_JSON_SSE2
+#endif
+#ifdef HELLO_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace {
+
+bool needs_escape(unsigned char c) {
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+// Bit i is set if byte i of the 16 at p needs escaping.
+unsigned escape_mask(const char* p) {
+#ifdef HELLO_JSON_SSE2
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i control = _mm_cmpeq_epi8(_mm_max_epu8(bytes, _mm_set1_epi8(0x1f)), _mm_set1_epi8(0x1f));
+    __m128i quote = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('"'));
+    __m128i backslash = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\\'));
+    return static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(control, _mm_or_si128(quote, backslash))));
+#else
+    unsigned mask = 0;
+    for (unsigned i = 0; i < 16; ++i) {
+        mask |= unsigned(needs_escape(static_cast<unsigned char>(p[i]))) << i;
+    }
+    return mask;
+#endif
+}
+
+unsigned lowest_bit(std::uint64_t mask) {
+#if defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_ctzll(mask));
+#else
+    unsigned i = 0;
+    while ((mask & 1) == 0) {
+        mask >>= 1;
+        ++i;
+    }
+    return i;
+#endif
+}
+
+char* write_escape(char* out, unsigned char c) {
+    static const char hex[] = "0123456789abcdef";
+    *out++ = '\\';
+    switch (c) {
+    case '"':
+        *out++ = '"';
+        break;
+    case '\\':
+        *out++ = '\\';
+        break;
+    case '\b':
+        *out++ = 'b';
+        break;
+    case '\f':
+        *out++ = 'f';
+        break;
+    case '\n':
+        *out++ = 'n';
+        break;
+    case '\r':
+        *out++ = 'r';
+        break;
+    case '\t':
+        *out++ = 't';
+        break;
+    default:
+        std::memcpy(out, "u00", 3);
+        out[3] = hex[c >> 4];
+        out[4] = hex[c & 0xf];
+        out += 5;
+        break;
+    }
+    return out;
+}
+
+// Copies the clean bytes before the first one that needs escaping, where
+// bit `first` of a block mask is set, and writes its escape.
+char* escape_first(char* out, const char*& p, unsigned first) {
+    std::memcpy(out, p, first);
+    out = write_escape(out + first, static_cast<unsigned char>(p[first]));
+    p += first + 1;
+    return out;
+}
+
+// Clean spans are found 16 bytes at a time and copied in bulk.
+char* escape_tail(char* out, const char* p, const char* end) {
+    while (end - p >= 16) {
+        if (unsigned mask = escape_mask(p)) {
+            out = escape_first(out, p, lowest_bit(mask));
+        } else {
+            std::memcpy(out, p, 16);
+            out += 16;
+            p += 16;
+        }
+    }
+    for (; p != end; ++p) {
+        if (needs_escape(static_cast<unsigned char>(*p))) {
+            out = write_escape(out, static_cast<unsigned char>(*p));
+        } else {
+            *out++ = *p;
+        }
+    }
+    return out;
+}
+
+#ifdef HELLO_X86_DISPATCH
+HELLO_TARGET("avx2") unsigned escape_mask_avx2(const char* p) {
+    __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i control = _mm256_cmpeq_epi8(_mm256_max_epu8(bytes, _mm256_set1_epi8(0x1f)), _mm256_set1_epi8(0x1f));
+    __m256i quote = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('"'));
+    __m256i backslash = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\\'));
+    return static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(control, _mm256_or_si256(quote, backslash))));
+}
+
+HELLO_TARGET("avx512f,avx512bw") std::uint64_t escape_mask_avx512(const char* p) {
+    __m512i bytes = _mm512_loadu_si512(p);
+    return _mm512_cmple_epu8_mask(bytes, _mm512_set1_epi8(0x1f)) | _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8('"')) |
+           _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8('\\'));
+}
+
+HELLO_TARGET("avx2") char* escape_avx2(char* out, const char* p, const char* end) {
+    while (end - p >= 32) {
+        if (unsigned mask = escape_mask_avx2(p)) {
+            out = escape_first(out, p, lowest_bit(mask));
+        } else {
+            std::memcpy(out, p, 32);
+            out += 32;
+            p += 32;
+        }
+    }
+    return escape_tail(out, p, end);
+}
+
+HELLO_TARGET("avx512f,avx512bw") char* escape_avx512(char* out, const char* p, const char* end) {
+    while (end - p >= 64) {
+        if (std::uint64_t mask = escape_mask_avx512(p)) {
+            out = escape_first(out, p, lowest_bit(mask));
+        } else {
+            std::memcpy(out, p, 64);
+            out += 64;
+            p += 64;
+        }
+    }
+    return escape_tail(out, p, end);
+}
+#endif
+
+} // namespace
+
+char* write_json_escaped(char* out, std::string_view s) {
+    using Escaper = char* (*)(char*, const char*, const char*);
+    static const Escaper escaper = [] {
+#ifdef HELLO_X86_DISPATCH
+        switch (cpu_level()) {
+        case CpuLevel::avx512:
+            return Escaper(escape_avx512);
+        case CpuLevel::avx2:
+            return Escaper(escape_avx2);
+        default:
+            break;
+        }
+#endif
+        return Escaper(escape_tail);
+    }();
+    return escaper(out, s.data(), s.data() + s.size());
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+// Upper bound of the escaped size of n input bytes.
+constexpr std::size_t json_escaped_bound(std::size_t n) {
+    return 6 * n;
+}
+
+// Writes s as the contents of a JSON string (without the quotes) and
+// returns the end of the output. s must be valid UTF-8; only '"', '\\' and
+// control characters are escaped. Clean spans are found 64, 32 or 16 bytes
+// at a time with AVX-512, AVX2 or SSE2, as the host allows, and copied in
+// bulk.
+char* write_json_escaped(char* out, std::string_view s);
@@ -0,0 +1,446 @@
+#include "jsonl_parser.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include "cpu_dispatch.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HELLO_JSONL_SSE2
+#endif
+#ifdef HELLO_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace {
+
+struct Masks {
+    std::uint64_t quote;
+    std::uint64_t backslash;
+    std::uint64_t structural; // { } [ ] : , and newline
+    std::uint64_t whitespace; // space, tab and carriage return
+};
+
+#ifdef HELLO_JSONL_SSE2
+std::uint64_t equal_mask(const __m128i chunk[4], char c) {
+    __m128i wanted = _mm_set1_epi8(c);
+    std::uint64_t mask = 0;
+    for (int i = 0; i < 4; ++i) {
+        mask |= std::uint64_t(static_cast<std::uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk[i], wanted))))
+                << (16 * i);
+    }
+    return mask;
+}
+#endif
+
+Masks classify(const char* p) {
+    Masks masks;
+#ifdef HELLO_JSONL_SSE2
+    __m128i chunk[4];
+    for (int i = 0; i < 4; ++i) {
+        chunk[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * i));
+    }
+    masks.quote = equal_mask(chunk, '"');
+    masks.backslash = equal_mask(chunk, '\\');
+    // '{' | 0x20 == '{' and '[' | 0x20 == '{', likewise for the closers.
+    __m128i folded[4];
+    for (int i = 0; i < 4; ++i) {
+        folded[i] = _mm_or_si128(chunk[i], _mm_set1_epi8(0x20));
+    }
+    masks.structural = equal_mask(folded, '{') | equal_mask(folded, '}') | equal_mask(chunk, ':') |
+                       equal_mask(chunk, ',') | equal_mask(chunk, '\n');
+    masks.whitespace = equal_mask(chunk, ' ') | equal_mask(chunk, '\t') | equal_mask(chunk, '\r');
+#else
+    masks = Masks{0, 0, 0, 0};
+    for (int i = 0; i < 64; ++i) {
+        std::uint64_t bit = std::uint64_t(1) << i;
+        switch (p[i]) {
+        case '"':
+            masks.quote |= bit;
+            break;
+        case '\\':
+            masks.backslash |= bit;
+            break;
+        case '{':
+        case '}':
+        case '[':
+        case ']':
+        case ':':
+        case ',':
+        case '\n':
+            masks.structural |= bit;
+            break;
+        case ' ':
+        case '\t':
+        case '\r':
+            masks.whitespace |= bit;
+            break;
+        default:
+            break;
+        }
+    }
+#endif
+    return masks;
+}
+
+#ifdef HELLO_X86_DISPATCH
+HELLO_TARGET("avx2") std::uint64_t equal_mask_avx2(__m256i low, __m256i high, char c) {
+    __m256i wanted = _mm256_set1_epi8(c);
+    return std::uint64_t(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, wanted)))) |
+           std::uint64_t(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, wanted)))) << 32;
+}
+
+HELLO_TARGET("avx2") Masks classify_avx2(const char* p) {
+    __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+    __m256i folded_low = _mm256_or_si256(low, _mm256_set1_epi8(0x20));
+    __m256i folded_high = _mm256_or_si256(high, _mm256_set1_epi8(0x20));
+    Masks masks;
+    masks.quote = equal_mask_avx2(low, high, '"');
+    masks.backslash = equal_mask_avx2(low, high, '\\');
+    masks.structural = equal_mask_avx2(folded_low, folded_high, '{') | equal_mask_avx2(folded_low, folded_high, '}') |
+                       equal_mask_avx2(low, high, ':') | equal_mask_avx2(low, high, ',') |
+                       equal_mask_avx2(low, high, '\n');
+    masks.whitespace =
+        equal_mask_avx2(low, high, ' ') | equal_mask_avx2(low, high, '\t') | equal_mask_avx2(low, high, '\r');
+    return masks;
+}
+
+HELLO_TARGET("avx512f,avx512bw") Masks classify_avx512(const char* p) {
+    __m512i chunk = _mm512_loadu_si512(p);
+    __m512i folded = _mm512_or_si512(chunk, _mm512_set1_epi8(0x20));
+    Masks masks;
+    masks.quote = _mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8('"'));
+    masks.backslash = _mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8('\\'));
+    masks.structural = _mm512_cmpeq_epi8_mask(folded, _mm512_set1_epi8('{')) |
+                       _mm512_cmpeq_epi8_mask(folded, _mm512_set1_epi8('}')) |
+                       _mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8(':')) |
+                       _mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8(',')) |
+                       _mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8('\n'));
+    masks.whitespace = _mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8(' ')) |
+                       _mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8('\t')) |
+                       _mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8('\r'));
+    return masks;
+}
+#endif
+
+using Classifier = Masks (*)(const char*);
+
+// The widest classify() the host supports.
+Classifier pick_classifier() {
+#ifdef HELLO_X86_DISPATCH
+    switch (cpu_level()) {
+    case CpuLevel::avx512:
+        return classify_avx512;
+    case CpuLevel::avx2:
+        return classify_avx2;
+    default:
+        break;
+    }
+#endif
+    return classify;
+}
+
+// Bit i of the result is the xor of bits 0..i of x: set inside strings when
+// x marks the quotes.
+std::uint64_t prefix_xor(std::uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+bool add_overflow(std::uint64_t a, std::uint64_t b, std::uint64_t* sum) {
+    *sum = a + b;
+    return *sum < a;
+}
+
+// Characters escaped by a backslash: those after an odd-length run of
+// backslashes. carry tells whether the previous chunk ended in one.
+std::uint64_t find_escaped(std::uint64_t backslash, std::uint64_t& carry) {
+    constexpr std::uint64_t even_bits = 0x5555555555555555ull;
+    backslash &= ~carry;
+    std::uint64_t follows_escape = (backslash << 1) | carry;
+    std::uint64_t odd_starts = backslash & ~even_bits & ~follows_escape;
+    std::uint64_t even_starts_end;
+    carry = add_overflow(odd_starts, backslash, &even_starts_end) ? 1 : 0;
+    std::uint64_t invert = even_starts_end << 1;
+    return (even_bits ^ invert) & follows_escape;
+}
+
+unsigned lowest_bit(std::uint64_t mask) {
+#if defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_ctzll(mask));
+#else
+    unsigned i = 0;
+    while ((mask & 1) == 0) {
+        mask >>= 1;
+        ++i;
+    }
+    return i;
+#endif
+}
+
+void append_utf8(std::string& out, std::uint32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xc0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3f));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xe0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (cp & 0x3f));
+    } else {
+        out += static_cast<char>(0xf0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3f));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (cp & 0x3f));
+    }
+}
+
+std::uint32_t parse_hex4(std::string_view s, std::size_t i) {
+    if (i + 4 > s.size()) {
+        throw std::runtime_error("truncated \\u escape in JSON string");
+    }
+    std::uint32_t value = 0;
+    for (std::size_t k = i; k < i + 4; ++k) {
+        char c = s[k];
+        value <<= 4;
+        if (c >= '0' && c <= '9') {
+            value |= c - '0';
+        } else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+            value |= (c | 0x20) - 'a' + 10;
+        } else {
+            throw std::runtime_error("invalid \\u escape in JSON string");
+        }
+    }
+    return value;
+}
+
+void unescape(std::string_view s, std::string& out) {
+    out.clear();
+    for (std::size_t i = 0; i < s.size(); ++i) {
+        if (s[i] != '\\') {
+            out += s[i];
+            continue;
+        }
+        if (++i == s.size()) {
+            throw std::runtime_error("invalid escape in JSON string");
+        }
+        switch (s[i]) {
+        case '"':
+        case '\\':
+        case '/':
+            out += s[i];
+            break;
+        case 'b':
+            out += '\b';
+            break;
+        case 'f':
+            out += '\f';
+            break;
+        case 'n':
+            out += '\n';
+            break;
+        case 'r':
+            out += '\r';
+            break;
+        case 't':
+            out += '\t';
+            break;
+        case 'u': {
+            std::uint32_t cp = parse_hex4(s, i + 1);
+            i += 4;
+            if (cp >= 0xd800 && cp < 0xdc00 && i + 2 < s.size() && s[i + 1] == '\\' && s[i + 2] == 'u') {
+                std::uint32_t low = parse_hex4(s, i + 3);
+                if (low >= 0xdc00 && low < 0xe000) {
+                    cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                    i += 6;
+                }
+            }
+            if (cp >= 0xd800 && cp < 0xe000) {
+                throw std::runtime_error("unpaired surrogate in JSON string");
+            }
+            append_utf8(out, cp);
+            break;
+        }
+        default:
+            throw std::runtime_error("invalid escape in JSON string");
+        }
+    }
+}
+
+// What the next token of a record's top-level object must be.
+enum class Expect { key_or_end, key, colon, value, comma_or_end };
+
+} // namespace
+
+void JsonlNameParser::find_structurals(std::string_view block) {
+    static const Classifier classify_chunk = pick_classifier();
+    indices_.clear();
+    std::uint64_t escape_carry = 0;
+    std::uint64_t in_string_carry = 0;
+    std::uint64_t scalar_carry = 0;
+    char padded[64];
+    for (std::size_t offset = 0; offset < block.size(); offset += 64) {
+        const char* p = block.data() + offset;
+        if (block.size() - offset < 64) {
+            std::memset(padded, ' ', sizeof(padded));
+            std::memcpy(padded, p, block.size() - offset);
+            p = padded;
+        }
+        Masks masks = classify_chunk(p);
+        std::uint64_t quotes = masks.quote & ~find_escaped(masks.backslash, escape_carry);
+        std::uint64_t in_string = prefix_xor(quotes) ^ in_string_carry;
+        in_string_carry = std::uint64_t(0) - (in_string >> 63);
+        // Anything else outside strings belongs to a scalar (a number,
+        // true, false, null or garbage); the first byte of each is indexed
+        // too, so stage 2 sees every token.
+        std::uint64_t scalar = ~(masks.structural | masks.whitespace | masks.quote | in_string);
+        std::uint64_t scalar_starts = scalar & ~((scalar << 1) | scalar_carry);
+        scalar_carry = scalar >> 63;
+        for (std::uint64_t bits = (masks.structural & ~in_string) | quotes | scalar_starts; bits != 0;
+             bits &= bits - 1) {
+            indices_.push_back(static_cast<std::uint32_t>(offset + lowest_bit(bits)));
+        }
+    }
+    if (in_string_carry != 0) {
+        throw std::runtime_error("unterminated JSON string");
+    }
+}
+
+std::string_view JsonlNameParser::string_at(std::string_view block, std::size_t open, std::size_t close,
+                                            std::string& scratch) {
+    std::string_view raw = block.substr(open + 1, close - open - 1);
+    if (raw.find('\\') == std::string_view::npos) {
+        return raw;
+    }
+    unescape(raw, scratch);
+    return scratch;
+}
+
+void JsonlNameParser::parse(std::string_view block,
+                            const std::function<void(std::string_view, std::string_view)>& f) {
+    if (block.size() > 0xffffffffu) {
+        throw std::length_error("JSON Lines block too large");
+    }
+    find_structurals(block);
+    const std::size_t count = indices_.size();
+    std::size_t depth = 0;
+    Expect expect = Expect::key_or_end;
+    std::string_view key;
+    bool line_has_record = false;
+    // A record's name is passed on only once the record is complete.
+    bool has_name = false;
+    std::string_view name;
+    std::string_view locale;
+    for (std::size_t i = 0; i < count; ++i) {
+        std::size_t position = indices_[i];
+        char c = block[position];
+        if (depth > 1) {
+            // Nested values are skipped; only their brackets are counted.
+            if (c == '{' || c == '[') {
+                ++depth;
+            } else if (c == '}' || c == ']') {
+                if (--depth == 1) {
+                    expect = Expect::comma_or_end;
+                }
+            } else if (c == '"') {
+                ++i;
+            } else if (c == '\n') {
+                throw std::runtime_error("unterminated JSON record");
+            }
+            continue;
+        }
+        switch (c) {
+        case '{':
+        case '[':
+            if (depth == 0) {
+                if (c != '{') {
+                    throw std::runtime_error("JSON Lines record is not an object");
+                }
+                if (line_has_record) {
+                    throw std::runtime_error("more than one JSON record on a line");
+                }
+                line_has_record = true;
+                expect = Expect::key_or_end;
+            } else if (expect != Expect::value) {
+                throw std::runtime_error("malformed JSON record");
+            }
+            ++depth;
+            break;
+        case '}':
+        case ']':
+            if (depth == 0) {
+                throw std::runtime_error("unbalanced JSON record");
+            }
+            if (c != '}' || (expect != Expect::comma_or_end && expect != Expect::key_or_end)) {
+                throw std::runtime_error("malformed JSON record");
+            }
+            depth = 0;
+            if (has_name) {
+                f(name, locale);
+            }
+            has_name = false;
+            locale = std::string_view();
+            break;
+        case ',':
+            if (depth == 0 || expect != Expect::comma_or_end) {
+                throw std::runtime_error("malformed JSON record");
+            }
+            expect = Expect::key;
+            break;
+        case ':':
+            if (depth == 0 || expect != Expect::colon) {
+                throw std::runtime_error("malformed JSON record");
+            }
+            expect = Expect::value;
+            break;
+        case '\n':
+            if (depth != 0) {
+                throw std::runtime_error("unterminated JSON record");
+            }
+            line_has_record = false;
+            break;
+        case '"': {
+            // Strings have no structural characters inside, so the closing
+            // quote is the next index.
+            std::size_t close = indices_[++i];
+            if (depth == 0) {
+                throw std::runtime_error("JSON Lines record is not an object");
+            }
+            if (expect == Expect::key || expect == Expect::key_or_end) {
+                key = block.substr(position + 1, close - position - 1);
+                expect = Expect::colon;
+                break;
+            }
+            if (expect != Expect::value) {
+                throw std::runtime_error("malformed JSON record");
+            }
+            if (key == "name") {
+                name = string_at(block, position, close, name_scratch_);
+                has_name = true;
+            } else if (key == "locale") {
+                locale = string_at(block, position, close, locale_scratch_);
+            }
+            expect = Expect::comma_or_end;
+            break;
+        }
+        default:
+            // The first byte of a scalar.
+            if (depth == 0 || expect != Expect::value) {
+                throw std::runtime_error("malformed JSON record");
+            }
+            expect = Expect::comma_or_end;
+            break;
+        }
+    }
+    if (depth != 0) {
+        throw std::runtime_error("unterminated JSON record");
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Extracts the "name" string, and the optional "locale" string, of every
+// record in a block of JSON Lines without building a document. Works in two
+// stages like simdjson: stage 1 classifies 64 bytes at a time into bitmasks
+// (quotes, backslashes, structural characters, whitespace), resolves
+// escapes and string interiors with bit arithmetic and records the
+// positions of the structural characters and of the first byte of every
+// scalar; stage 2 walks only those positions. Records without a string
+// "name" member are skipped.
+//
+// Stage 2 checks the grammar of each record's top-level object: one object
+// per line, string keys, and ':' and ',' where JSON puts them. Scalar
+// values are not parsed, and nested arrays and objects are only checked
+// for balanced brackets.
+class JsonlNameParser {
+public:
+    // Calls f(name, locale) for every record; locale is empty when the
+    // record has none. block must hold whole lines. Throws
+    // std::runtime_error on malformed input.
+    void parse(std::string_view block, const std::function<void(std::string_view, std::string_view)>& f);
+
+private:
+    void find_structurals(std::string_view block);
+    std::string_view string_at(std::string_view block, std::size_t open, std::size_t close, std::string& scratch);
+
+    std::vector<std::uint32_t> indices_;
+    std::string name_scratch_;
+    std::string locale_scratch_;
+};
@@ -0,0 +1,47 @@
+#include "mapped_file.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define HELLO_HAVE_MMAP
+#endif
+
+std::unique_ptr<MappedFile> MappedFile::open(const std::string& path) {
+#ifdef HELLO_HAVE_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return nullptr;
+    }
+    std::size_t size = static_cast<std::size_t>(st.st_size);
+    if (size == 0) {
+        close(fd);
+        return std::unique_ptr<MappedFile>(new MappedFile(nullptr, 0));
+    }
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return nullptr;
+    }
+    // Chunks are read front to back, several at a time.
+    madvise(data, size, MADV_SEQUENTIAL);
+    return std::unique_ptr<MappedFile>(new MappedFile(static_cast<const char*>(data), size));
+#else
+    (void)path;
+    return nullptr;
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifdef HELLO_HAVE_MMAP
+    if (size_ != 0) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Read-only memory mapping of a whole regular file.
+class MappedFile {
+public:
+    // Returns null if path is not a regular file or the platform has no
+    // mmap; callers then read it as a stream.
+    static std::unique_ptr<MappedFile> open(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view data() const {
+        return std::string_view(data_, size_);
+    }
+
+private:
+    MappedFile(const char* data, std::size_t size) : data_(data), size_(size) {}
+
+    const char* data_;
+    std::size_t size_;
+};
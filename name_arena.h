@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+// Reference to a name stored in a NameArena: 40-bit offset, 24-bit length.
+struct NameRef {
+    std::uint64_t offset : 40;
+    std::uint64_t length : 24;
+};
+
+// Interned names stored back to back in one growing byte array, so a large
+// name list costs its bytes plus eight per name instead of a std::string
+// (and usually a heap block) each.
+class NameArena {
+public:
+    static constexpr std::size_t max_length = (1u << 24) - 1;
+
+    NameRef add(std::string_view name) {
+        if (name.size() > max_length) {
+            throw std::length_error("name too long");
+        }
+        NameRef ref;
+        ref.offset = bytes_.size();
+        ref.length = name.size();
+        bytes_.insert(bytes_.end(), name.begin(), name.end());
+        return ref;
+    }
+
+    std::string_view view(NameRef ref) const {
+        return std::string_view(bytes_.data() + ref.offset, ref.length);
+    }
+
+    std::size_t size_bytes() const {
+        return bytes_.size();
+    }
+
+    std::size_t capacity_bytes() const {
+        return bytes_.capacity();
+    }
+
+    void reserve(std::size_t bytes) {
+        bytes_.reserve(bytes);
+    }
+
+private:
+    std::vector<char> bytes_;
+};
@@ -0,0 +1,125 @@
+#include "name_set.h"
+
+#include "hash.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HELLO_NAME_SET_SSE2
+#endif
+
+namespace {
+
+// Bit i of the result is set if control byte i of the group equals value.
+std::uint32_t match(const std::uint8_t* group, std::uint8_t value) {
+#ifdef HELLO_NAME_SET_SSE2
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+    __m128i wanted = _mm_set1_epi8(static_cast<char>(value));
+    return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, wanted)));
+#else
+    std::uint32_t mask = 0;
+    for (unsigned i = 0; i < 16; ++i) {
+        mask |= std::uint32_t(group[i] == value) << i;
+    }
+    return mask;
+#endif
+}
+
+unsigned lowest_bit(std::uint32_t mask) {
+#if defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#elif defined(_MSC_VER)
+    unsigned long i;
+    _BitScanForward(&i, mask);
+    return static_cast<unsigned>(i);
+#else
+    unsigned i = 0;
+    while ((mask & 1) == 0) {
+        mask >>= 1;
+        ++i;
+    }
+    return i;
+#endif
+}
+
+std::uint8_t tag(std::uint64_t hash) {
+    return static_cast<std::uint8_t>(hash >> 57);
+}
+
+} // namespace
+
+NameSet::NameSet(NameArena& arena, std::size_t expected) : arena_(arena) {
+    std::size_t capacity = group_size;
+    while (capacity * 7 / 8 < expected) {
+        capacity *= 2;
+    }
+    rehash(capacity);
+}
+
+std::pair<NameRef, bool> NameSet::insert(std::string_view name) {
+    std::uint64_t hash = hash_bytes(name);
+    bool found;
+    std::size_t index = find(name, hash, found);
+    if (found) {
+        return {slots_[index], false};
+    }
+    if ((size_ + 1) * 8 > control_.size() * 7) {
+        rehash(control_.size() * 2);
+        index = find(name, hash, found);
+    }
+    control_[index] = tag(hash);
+    slots_[index] = arena_.add(name);
+    ++size_;
+    return {slots_[index], true};
+}
+
+bool NameSet::contains(std::string_view name) const {
+    bool found;
+    find(name, hash_bytes(name), found);
+    return found;
+}
+
+std::size_t NameSet::find(std::string_view name, std::uint64_t hash, bool& found) const {
+    std::uint8_t wanted = tag(hash);
+    std::size_t group = hash & group_mask_;
+    // Triangular probing visits every group once when the count is a power
+    // of two.
+    for (std::size_t step = 1;; ++step) {
+        const std::uint8_t* control = control_.data() + group * group_size;
+        for (std::uint32_t mask = match(control, wanted); mask != 0; mask &= mask - 1) {
+            std::size_t index = group * group_size + lowest_bit(mask);
+            if (arena_.view(slots_[index]) == name) {
+                found = true;
+                return index;
+            }
+        }
+        std::uint32_t free = match(control, empty);
+        if (free != 0) {
+            found = false;
+            return group * group_size + lowest_bit(free);
+        }
+        group = (group + step) & group_mask_;
+    }
+}
+
+void NameSet::rehash(std::size_t capacity) {
+    std::vector<std::uint8_t> old_control(capacity, empty);
+    std::vector<NameRef> old_slots(capacity);
+    old_control.swap(control_);
+    old_slots.swap(slots_);
+    group_mask_ = capacity / group_size - 1;
+    for (std::size_t i = 0; i < old_control.size(); ++i) {
+        if (old_control[i] == empty) {
+            continue;
+        }
+        std::string_view name = arena_.view(old_slots[i]);
+        std::uint64_t hash = hash_bytes(name);
+        bool found;
+        std::size_t index = find(name, hash, found);
+        control_[index] = tag(hash);
+        slots_[index] = old_slots[i];
+    }
+}
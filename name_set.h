@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "name_arena.h"
+
+// Open-addressing hash set of names in the style of Swiss tables. Slots are
+// NameRefs into a NameArena; a parallel array holds one control byte per
+// slot (empty, or seven bits of the hash). Lookups scan a group of 16
+// control bytes at once with SSE2 and only compare names whose tag matches.
+class NameSet {
+public:
+    explicit NameSet(NameArena& arena, std::size_t expected = 0);
+
+    // Interns name into the arena unless an equal name is already present.
+    // Returns the stored reference and whether it was newly inserted.
+    std::pair<NameRef, bool> insert(std::string_view name);
+
+    bool contains(std::string_view name) const;
+
+    std::size_t size() const {
+        return size_;
+    }
+
+    // Bytes held by the table itself, not counting the arena.
+    std::size_t memory_usage() const {
+        return control_.capacity() + slots_.capacity() * sizeof(NameRef);
+    }
+
+private:
+    static constexpr std::size_t group_size = 16;
+    static constexpr std::uint8_t empty = 0x80;
+
+    // Index of the first slot whose name equals name, or of the empty slot
+    // where it would go; found tells which.
+    std::size_t find(std::string_view name, std::uint64_t hash, bool& found) const;
+    void rehash(std::size_t capacity);
+
+    NameArena& arena_;
+    std::vector<std::uint8_t> control_;
+    std::vector<NameRef> slots_;
+    std::size_t size_ = 0;
+    std::size_t group_mask_ = 0;
+};
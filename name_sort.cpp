@@ -0,0 +1,160 @@
+#include "name_sort.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+constexpr std::size_t comparison_cutoff = 64;
+constexpr std::size_t task_cutoff = 1 << 14;
+
+struct Task {
+    std::size_t begin;
+    std::size_t end;
+    std::size_t depth;
+};
+
+class RadixSort {
+public:
+    RadixSort(const NameArena& arena, std::vector<NameRef>& refs) : arena_(arena), refs_(refs), temp_(refs.size()) {}
+
+    void run(unsigned threads, const CpuSet& cpus) {
+        tasks_.push_back({0, refs_.size(), 0});
+        pending_ = 1;
+        std::vector<std::thread> workers;
+        for (unsigned i = cpus.empty() ? 1 : 0; i < threads; ++i) {
+            workers.emplace_back([this, &cpus] {
+                if (pin(cpus)) {
+                    work();
+                }
+            });
+        }
+        if (cpus.empty()) {
+            work();
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+    }
+
+private:
+    // A worker that cannot be pinned does no work; run() reports why.
+    bool pin(const CpuSet& cpus) {
+        try {
+            pin_current_thread(cpus);
+            return true;
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!error_) {
+                error_ = std::current_exception();
+            }
+            return false;
+        }
+    }
+
+    void work() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            wake_.wait(lock, [this] { return !tasks_.empty() || pending_ == 0; });
+            if (tasks_.empty()) {
+                return;
+            }
+            Task task = tasks_.back();
+            tasks_.pop_back();
+            lock.unlock();
+            sort(task.begin, task.end, task.depth);
+            lock.lock();
+            if (--pending_ == 0) {
+                wake_.notify_all();
+            }
+        }
+    }
+
+    void spawn(std::size_t begin, std::size_t end, std::size_t depth) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.push_back({begin, end, depth});
+            ++pending_;
+        }
+        wake_.notify_one();
+    }
+
+    // 0 for names that end before depth, so they sort first.
+    unsigned key(NameRef ref, std::size_t depth) const {
+        if (depth >= ref.length) {
+            return 0;
+        }
+        return 1 + static_cast<unsigned char>(arena_.view(ref)[depth]);
+    }
+
+    void sort(std::size_t begin, std::size_t end, std::size_t depth) {
+        while (end - begin > comparison_cutoff) {
+            std::size_t counts[257] = {};
+            for (std::size_t i = begin; i < end; ++i) {
+                ++counts[key(refs_[i], depth)];
+            }
+            std::size_t offsets[257];
+            std::size_t offset = begin;
+            for (unsigned b = 0; b < 257; ++b) {
+                offsets[b] = offset;
+                offset += counts[b];
+            }
+            for (std::size_t i = begin; i < end; ++i) {
+                temp_[offsets[key(refs_[i], depth)]++] = refs_[i];
+            }
+            std::memcpy(refs_.data() + begin, temp_.data() + begin, (end - begin) * sizeof(NameRef));
+
+            // Bucket 0 holds equal names. Of the others, big ones go to the
+            // pool and small ones are sorted here; the largest continues in
+            // this loop to keep the stack flat.
+            unsigned largest = 1;
+            for (unsigned b = 2; b < 257; ++b) {
+                if (counts[b] > counts[largest]) {
+                    largest = b;
+                }
+            }
+            for (unsigned b = 1; b < 257; ++b) {
+                if (b == largest || counts[b] < 2) {
+                    continue;
+                }
+                if (counts[b] > task_cutoff) {
+                    spawn(offsets[b] - counts[b], offsets[b], depth + 1);
+                } else {
+                    sort(offsets[b] - counts[b], offsets[b], depth + 1);
+                }
+            }
+            begin = offsets[largest] - counts[largest];
+            end = offsets[largest];
+            ++depth;
+        }
+        std::sort(refs_.begin() + begin, refs_.begin() + end, [&](NameRef a, NameRef b) {
+            return arena_.view(a).substr(std::min<std::size_t>(depth, a.length)) <
+                   arena_.view(b).substr(std::min<std::size_t>(depth, b.length));
+        });
+    }
+
+    const NameArena& arena_;
+    std::vector<NameRef>& refs_;
+    std::vector<NameRef> temp_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::vector<Task> tasks_;
+    std::size_t pending_ = 0;
+    std::exception_ptr error_;
+};
+
+} // namespace
+
+void sort_names(const NameArena& arena, std::vector<NameRef>& refs, unsigned threads, const CpuSet& cpus) {
+    if (refs.size() < 2) {
+        return;
+    }
+    RadixSort(arena, refs).run(std::max(1u, threads), cpus);
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <vector>
+
+#include "cpu_affinity.h"
+#include "name_arena.h"
+
+// Sorts refs by the bytes of their names (unsigned, shorter prefix first)
+// with a most-significant-byte radix sort. Buckets larger than a cutoff
+// become tasks for a pool of threads; small ones finish with a comparison
+// sort on the remaining suffixes. The calling thread takes part, unless
+// the pool is pinned to cpus: then it only waits.
+void sort_names(const NameArena& arena, std::vector<NameRef>& refs, unsigned threads,
+                const CpuSet& cpus = CpuSet());
@@ -0,0 +1,172 @@
+#include "name_stats.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "hash.h"
+
+double DistinctCounter::estimate() const {
+    double m = static_cast<double>(registers_.size());
+    double sum = 0;
+    std::size_t zeros = 0;
+    for (std::uint8_t rank : registers_) {
+        sum += std::ldexp(1.0, -rank);
+        zeros += rank == 0;
+    }
+    double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+    if (estimate <= 2.5 * m && zeros != 0) {
+        // Linear counting is more accurate while many registers are empty.
+        estimate = m * std::log(m / static_cast<double>(zeros));
+    }
+    return estimate;
+}
+
+unsigned DistinctCounter::leading_zeros(std::uint64_t x) {
+#if defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_clzll(x));
+#else
+    unsigned n = 0;
+    for (std::uint64_t bit = std::uint64_t(1) << 63; (x & bit) == 0; bit >>= 1) {
+        ++n;
+    }
+    return n;
+#endif
+}
+
+TopNames::TopNames(std::size_t k) : k_(std::max<std::size_t>(k, 1)) {
+    // Reported counts are only as good as n / (tracked names), so track
+    // many more names than are reported.
+    k = std::max<std::size_t>(k_ * 8, 1024);
+    slots_.reserve(k);
+    heap_.reserve(k);
+    std::size_t index_size = 4;
+    while (index_size < 2 * k) {
+        index_size *= 2;
+    }
+    index_.assign(index_size, none);
+    index_mask_ = index_size - 1;
+}
+
+void TopNames::add(std::string_view name, std::uint64_t hash) {
+    std::uint32_t id = find(name, hash);
+    if (id == none) {
+        if (slots_.size() < slots_.capacity()) {
+            id = static_cast<std::uint32_t>(slots_.size());
+            slots_.push_back({{std::string(name), 0, 0}, hash, static_cast<std::uint32_t>(heap_.size())});
+            heap_.push_back(id);
+            sift_up(slots_[id].heap_position);
+        } else {
+            // Take over the slot with the smallest count.
+            id = heap_[0];
+            index_erase(id);
+            Slot& slot = slots_[id];
+            slot.entry.name.assign(name.data(), name.size());
+            slot.entry.error = slot.entry.count;
+            slot.hash = hash;
+        }
+        index_insert(id);
+    }
+    ++slots_[id].entry.count;
+    sift_down(slots_[id].heap_position);
+}
+
+std::vector<TopNames::Entry> TopNames::top() const {
+    std::vector<Entry> entries;
+    for (const Slot& slot : slots_) {
+        entries.push_back(slot.entry);
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.count != b.count ? a.count > b.count : a.name < b.name;
+    });
+    entries.resize(std::min(entries.size(), k_));
+    return entries;
+}
+
+std::uint32_t TopNames::find(std::string_view name, std::uint64_t hash) const {
+    for (std::size_t i = hash & index_mask_;; i = (i + 1) & index_mask_) {
+        std::uint32_t id = index_[i];
+        if (id == none) {
+            return none;
+        }
+        if (slots_[id].hash == hash && slots_[id].entry.name == name) {
+            return id;
+        }
+    }
+}
+
+void TopNames::index_insert(std::uint32_t id) {
+    std::size_t i = slots_[id].hash & index_mask_;
+    while (index_[i] != none) {
+        i = (i + 1) & index_mask_;
+    }
+    index_[i] = id;
+}
+
+void TopNames::index_erase(std::uint32_t id) {
+    std::size_t i = slots_[id].hash & index_mask_;
+    while (index_[i] != id) {
+        i = (i + 1) & index_mask_;
+    }
+    // Backward shift deletion keeps probe sequences unbroken without
+    // tombstones.
+    for (std::size_t j = (i + 1) & index_mask_; index_[j] != none; j = (j + 1) & index_mask_) {
+        std::size_t home = slots_[index_[j]].hash & index_mask_;
+        if (((j - home) & index_mask_) >= ((j - i) & index_mask_)) {
+            index_[i] = index_[j];
+            i = j;
+        }
+    }
+    index_[i] = none;
+}
+
+void TopNames::sift_up(std::uint32_t position) {
+    while (position != 0) {
+        std::uint32_t parent = (position - 1) / 2;
+        if (slots_[heap_[parent]].entry.count <= slots_[heap_[position]].entry.count) {
+            return;
+        }
+        swap_heap(parent, position);
+        position = parent;
+    }
+}
+
+void TopNames::sift_down(std::uint32_t position) {
+    std::size_t size = heap_.size();
+    for (;;) {
+        std::size_t smallest = position;
+        for (std::size_t child = 2 * position + 1; child <= 2 * position + 2 && child < size; ++child) {
+            if (slots_[heap_[child]].entry.count < slots_[heap_[smallest]].entry.count) {
+                smallest = child;
+            }
+        }
+        if (smallest == position) {
+            return;
+        }
+        swap_heap(position, static_cast<std::uint32_t>(smallest));
+        position = static_cast<std::uint32_t>(smallest);
+    }
+}
+
+void TopNames::swap_heap(std::uint32_t a, std::uint32_t b) {
+    std::swap(heap_[a], heap_[b]);
+    slots_[heap_[a]].heap_position = a;
+    slots_[heap_[b]].heap_position = b;
+}
+
+void NameStats::add(std::string_view name, std::size_t bytes) {
+    std::uint64_t hash = hash_bytes(name);
+    ++greetings_;
+    bytes_ += bytes;
+    distinct_.add(hash);
+    top_.add(name, hash);
+}
+
+void NameStats::report(std::ostream& out) const {
+    out << "greetings: " << greetings_ << '\n';
+    out << "bytes: " << bytes_ << '\n';
+    out << "distinct names (estimate): " << static_cast<std::uint64_t>(std::llround(distinct_.estimate())) << '\n';
+    out << "top names (count, max overestimate):\n";
+    for (const auto& entry : top_.top()) {
+        out << "  " << entry.count << ' ' << entry.error << ' ' << entry.name << '\n';
+    }
+}
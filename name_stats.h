@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// HyperLogLog distinct count with 2^14 one-byte registers (about 0.8 %
+// standard error in 16 KiB).
+class DistinctCounter {
+public:
+    DistinctCounter() : registers_(std::size_t(1) << precision) {}
+
+    void add(std::uint64_t hash) {
+        std::size_t index = hash >> (64 - precision);
+        std::uint64_t rest = (hash << precision) | (std::uint64_t(1) << (precision - 1));
+        std::uint8_t rank = static_cast<std::uint8_t>(leading_zeros(rest) + 1);
+        if (rank > registers_[index]) {
+            registers_[index] = rank;
+        }
+    }
+
+    double estimate() const;
+
+private:
+    static constexpr unsigned precision = 14;
+
+    static unsigned leading_zeros(std::uint64_t x);
+
+    std::vector<std::uint8_t> registers_;
+};
+
+// Space-Saving heavy hitters over a fixed number of tracked names. An
+// untracked name replaces the one with the smallest count and inherits that
+// count as its error, so every name seen more than n / tracked times is
+// guaranteed to be tracked. top() reports the k largest.
+class TopNames {
+public:
+    struct Entry {
+        std::string name;
+        std::uint64_t count;
+        std::uint64_t error; // count may be overestimated by up to this
+    };
+
+    explicit TopNames(std::size_t k);
+
+    void add(std::string_view name, std::uint64_t hash);
+
+    // Tracked names, most frequent first.
+    std::vector<Entry> top() const;
+
+private:
+    static constexpr std::uint32_t none = 0xffffffff;
+
+    struct Slot {
+        Entry entry;
+        std::uint64_t hash;
+        std::uint32_t heap_position;
+    };
+
+    std::uint32_t find(std::string_view name, std::uint64_t hash) const;
+    void index_insert(std::uint32_t id);
+    void index_erase(std::uint32_t id);
+    void sift_up(std::uint32_t position);
+    void sift_down(std::uint32_t position);
+    void swap_heap(std::uint32_t a, std::uint32_t b);
+
+    std::size_t k_;
+    std::vector<Slot> slots_;
+    std::vector<std::uint32_t> heap_;  // slot ids, min-heap on count
+    std::vector<std::uint32_t> index_; // open addressing by hash, slot ids
+    std::size_t index_mask_;
+};
+
+// Counters and sketches for the --stats report of the personalized mode.
+class NameStats {
+public:
+    explicit NameStats(std::size_t top_k) : top_(top_k) {}
+
+    void add(std::string_view name, std::size_t bytes);
+
+    void report(std::ostream& out) const;
+
+private:
+    std::uint64_t greetings_ = 0;
+    std::uint64_t bytes_ = 0;
+    DistinctCounter distinct_;
+    TopNames top_;
+};
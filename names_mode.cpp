@@ -0,0 +1,549 @@
+#include "names_mode.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "counter_store.h"
+#include "external_sort.h"
+#include "frame_writer.h"
+#include "greeting.h"
+#include "greeting_jobs.h"
+#include "json_escape.h"
+#include "jsonl_parser.h"
+#include "mapped_file.h"
+#include "name_arena.h"
+#include "name_set.h"
+#include "name_sort.h"
+#include "name_stats.h"
+#include "utf8.h"
+
+namespace {
+
+// Writes greetings and, with a counter store, counts the greeted names in
+// batches so the store's lock is taken rarely.
+class Greeter {
+public:
+    Greeter(const NamesOptions& options, OutputBuffer& out)
+        : out_(out), format_(options.format),
+          catalog_(options.catalog.empty() ? GreetingCatalog() : GreetingCatalog::load(options.catalog)) {
+        if (!options.counts_db.empty()) {
+            store_ = std::make_unique<CounterStore>(options.counts_db);
+        }
+        if (options.stats) {
+            stats_ = std::make_unique<NameStats>(options.top_k);
+        }
+        if (format_ == OutputFormat::binary) {
+            frames_ = std::make_unique<FrameWriter>(out_);
+        }
+    }
+
+    // Writes out everything still batched and reports the stats. Throws if
+    // the counts could not all be stored.
+    void finish() {
+        if (store_) {
+            if (!batch_.empty()) {
+                store_->add_batch(batch_);
+                batch_.clear();
+            }
+            store_->close();
+        }
+        if (frames_) {
+            frames_->flush();
+        }
+        if (stats_) {
+            stats_->report(std::cerr);
+        }
+    }
+
+    void greet(std::string_view name) {
+        greet(name, 0, std::string_view());
+    }
+
+    // Greets each job with the catalog word of its template. Text output is
+    // written for the whole batch by greet_jobs(); the other formats need
+    // the locale or a frame per record.
+    void greet(const GreetingJobs& jobs) {
+        if (format_ != OutputFormat::text) {
+            for (std::size_t i = 0; i < jobs.size(); ++i) {
+                greet(jobs.names[i], jobs.templates[i], jobs.locales[i]);
+            }
+            return;
+        }
+        std::size_t size = greeting_lines_size(jobs, catalog_);
+        char* begin = out_.reserve(size);
+        out_.commit(greet_jobs(jobs, catalog_, begin) - begin);
+        if (stats_ || store_) {
+            for (std::size_t i = 0; i < jobs.size(); ++i) {
+                count(jobs.names[i], greeting_size(catalog_.word(jobs.templates[i]), jobs.names[i]) + 1);
+            }
+        }
+    }
+
+    const GreetingCatalog& catalog() const {
+        return catalog_;
+    }
+
+private:
+    static constexpr std::size_t batch_size = 4096;
+
+    void greet(std::string_view name, std::uint32_t template_id, std::string_view locale) {
+        std::string_view word = catalog_.word(template_id);
+        std::size_t size;
+        switch (format_) {
+        case OutputFormat::jsonl:
+            size = write_json(word, name, locale);
+            break;
+        case OutputFormat::binary:
+            size = write_frame(word, name);
+            break;
+        default:
+            size = write_text(template_id, word, name);
+            break;
+        }
+        count(name, size);
+    }
+
+    // Feeds a greeting of size output bytes to the stats and the store.
+    void count(std::string_view name, std::size_t size) {
+        if (stats_) {
+            stats_->add(name, size);
+        }
+        if (store_) {
+            batch_.emplace_back(name);
+            if (batch_.size() == batch_size) {
+                store_->add_batch(batch_);
+                batch_.clear();
+            }
+        }
+    }
+
+    // Template 0 is greeting_word, which write_greeting() copies as a
+    // constant.
+    std::size_t write_text(std::uint32_t template_id, std::string_view word, std::string_view name) {
+        std::size_t size = greeting_size(word, name) + 1;
+        char* p = out_.reserve(size);
+        char* end = template_id == 0 ? write_greeting(p, name) : write_greeting(p, word, name);
+        *end = '\n';
+        out_.commit(size);
+        return size;
+    }
+
+    // {"greeting":"<word>","name":"<name>"}, with a "locale" member when
+    // the record had one.
+    std::size_t write_json(std::string_view word, std::string_view name, std::string_view locale) {
+        static constexpr std::string_view greeting_key = "{\"greeting\":\"";
+        static constexpr std::string_view name_key = "\",\"name\":\"";
+        static constexpr std::string_view locale_key = "\",\"locale\":\"";
+        static constexpr std::string_view suffix = "\"}\n";
+        std::size_t bound = greeting_key.size() + name_key.size() + locale_key.size() + suffix.size() +
+                            json_escaped_bound(word.size() + name.size() + locale.size());
+        char* begin = out_.reserve(bound);
+        char* p = copy(begin, greeting_key);
+        p = copy(write_json_escaped(p, word), name_key);
+        p = write_json_escaped(p, name);
+        if (!locale.empty()) {
+            p = write_json_escaped(copy(p, locale_key), locale);
+        }
+        p = copy(p, suffix);
+        std::size_t size = p - begin;
+        out_.commit(size);
+        return size;
+    }
+
+    std::size_t write_frame(std::string_view word, std::string_view name) {
+        std::size_t size = greeting_size(word, name);
+        char* begin = frames_->begin_record(size);
+        frames_->end_record(write_greeting(begin, word, name));
+        return size;
+    }
+
+    static char* copy(char* out, std::string_view s) {
+        std::memcpy(out, s.data(), s.size());
+        return out + s.size();
+    }
+
+    OutputBuffer& out_;
+    OutputFormat format_;
+    GreetingCatalog catalog_;
+    std::unique_ptr<FrameWriter> frames_;
+    std::unique_ptr<CounterStore> store_;
+    std::unique_ptr<NameStats> stats_;
+    std::vector<std::string> batch_;
+};
+
+void check_utf8(std::string_view block, std::uint64_t offset) {
+    if (!validate_utf8(block.data(), block.size())) {
+        throw std::runtime_error("names input is not valid UTF-8 (in bytes " + std::to_string(offset) + " to " +
+                                 std::to_string(offset + block.size()) + ")");
+    }
+}
+
+// Reads in as large blocks of whole lines and calls f for each. Every
+// block is validated as UTF-8 in one pass before it is passed on.
+template <typename F>
+void for_each_block(std::FILE* in, F f) {
+    std::vector<char> buffer(1 << 20);
+    std::size_t size = 0;
+    std::uint64_t offset = 0;
+    for (bool eof = false; !eof;) {
+        if (size == buffer.size()) {
+            buffer.resize(buffer.size() * 2);
+        }
+        std::size_t n = std::fread(buffer.data() + size, 1, buffer.size() - size, in);
+        if (n == 0 && std::ferror(in)) {
+            throw std::runtime_error("cannot read names");
+        }
+        eof = n == 0;
+        size += n;
+
+        // Complete lines only, unless this is the end of the input.
+        std::size_t end = size;
+        if (!eof) {
+            while (end > 0 && buffer[end - 1] != '\n') {
+                --end;
+            }
+            if (end == 0) {
+                continue;
+            }
+        }
+        std::string_view block(buffer.data(), end);
+        check_utf8(block, offset);
+        f(block);
+        std::memmove(buffer.data(), buffer.data() + end, size - end);
+        size -= end;
+        offset += end;
+    }
+}
+
+// Calls f for each non-empty line of block, without a trailing '\r'.
+template <typename F>
+void for_each_line(std::string_view block, F f) {
+    for (std::size_t begin = 0; begin < block.size();) {
+        const char* newline = static_cast<const char*>(std::memchr(block.data() + begin, '\n', block.size() - begin));
+        std::size_t stop = newline != nullptr ? static_cast<std::size_t>(newline - block.data()) : block.size();
+        std::string_view name = block.substr(begin, stop - begin);
+        if (!name.empty() && name.back() == '\r') {
+            name.remove_suffix(1);
+        }
+        if (!name.empty()) {
+            f(name);
+        }
+        begin = stop + 1;
+    }
+}
+
+// The records of one chunk of a mapped file. Names and locales point into
+// the mapping, except JSON strings with escapes, which are unescaped into
+// storage.
+struct ParsedChunk {
+    std::vector<std::string_view> names;
+    std::vector<std::string_view> locales; // JSON Lines only
+    std::deque<std::string> storage;
+};
+
+ParsedChunk parse_chunk(std::string_view chunk, std::uint64_t offset, InputFormat format) {
+    check_utf8(chunk, offset);
+    ParsedChunk parsed;
+    if (format == InputFormat::text) {
+        for_each_line(chunk, [&](std::string_view name) { parsed.names.push_back(name); });
+        return parsed;
+    }
+    auto keep = [&](std::string_view s) {
+        if (s.empty() || (s.data() >= chunk.data() && s.data() < chunk.data() + chunk.size())) {
+            return s;
+        }
+        return std::string_view(parsed.storage.emplace_back(s));
+    };
+    JsonlNameParser parser;
+    parser.parse(chunk, [&](std::string_view name, std::string_view locale) {
+        parsed.names.push_back(keep(name));
+        parsed.locales.push_back(keep(locale));
+    });
+    return parsed;
+}
+
+// Where the names come from. A regular file is mapped and cut into
+// newline-aligned chunks that up to threads workers validate and parse in
+// parallel, while the records of finished chunks are passed on in file
+// order. Anything else is read as a stream.
+struct NameInput {
+    std::FILE* stream = nullptr;
+    std::unique_ptr<MappedFile> mapped;
+    InputFormat format = InputFormat::text;
+    unsigned threads = 1;
+    CpuSet cpus;
+};
+
+constexpr std::size_t chunk_size = 4 << 20;
+
+// Length of the chunk starting at begin: chunk_size rounded up to the end
+// of a line.
+std::size_t chunk_length(std::string_view data, std::size_t begin) {
+    std::size_t end = std::min(data.size(), begin + chunk_size);
+    if (end < data.size()) {
+        const char* newline = static_cast<const char*>(std::memchr(data.data() + end, '\n', data.size() - end));
+        end = newline != nullptr ? static_cast<std::size_t>(newline - data.data()) + 1 : data.size();
+    }
+    return end - begin;
+}
+
+// Parses the chunks of a mapping on input.threads long-lived workers. The
+// workers take chunk indices in order and stay at most one chunk per
+// worker ahead of the reader, which gets the chunks back in file order.
+class ChunkParser {
+public:
+    ChunkParser(std::string_view data, const NameInput& input)
+        : data_(data), format_(input.format), slots_(input.threads + 1) {
+        for (std::size_t begin = 0; begin < data.size(); begin += chunks_.back()) {
+            chunks_.push_back(chunk_length(data, begin));
+        }
+        for (unsigned i = 0; i < input.threads; ++i) {
+            workers_.emplace_back([this, &cpus = input.cpus] { work(cpus); });
+        }
+    }
+
+    ~ChunkParser() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        room_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    ChunkParser(const ChunkParser&) = delete;
+    ChunkParser& operator=(const ChunkParser&) = delete;
+
+    // Moves the next chunk into parsed; false once all have been read.
+    // Rethrows what the chunk's worker threw.
+    bool next(ParsedChunk& parsed) {
+        if (read_ == chunks_.size()) {
+            return false;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        Slot& slot = slots_[read_ % slots_.size()];
+        done_.wait(lock, [&] { return slot.ready || error_; });
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+        if (slot.error) {
+            std::rethrow_exception(slot.error);
+        }
+        parsed = std::move(slot.parsed);
+        slot.ready = false;
+        ++read_;
+        lock.unlock();
+        room_.notify_all();
+        return true;
+    }
+
+private:
+    struct Slot {
+        ParsedChunk parsed;
+        std::exception_ptr error;
+        bool ready = false;
+    };
+
+    // A worker that cannot be pinned parses nothing; next() reports why.
+    void work(const CpuSet& cpus) {
+        try {
+            pin_current_thread(cpus);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!error_) {
+                error_ = std::current_exception();
+            }
+            done_.notify_all();
+            return;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            room_.wait(lock, [&] { return stop_ || taken_ == chunks_.size() || taken_ < read_ + slots_.size(); });
+            if (stop_ || taken_ == chunks_.size()) {
+                return;
+            }
+            std::size_t index = taken_++;
+            std::size_t begin = begin_;
+            begin_ += chunks_[index];
+            lock.unlock();
+            Slot result;
+            try {
+                result.parsed = parse_chunk(data_.substr(begin, chunks_[index]), begin, format_);
+            } catch (...) {
+                result.error = std::current_exception();
+            }
+            result.ready = true;
+            lock.lock();
+            slots_[index % slots_.size()] = std::move(result);
+            done_.notify_all();
+        }
+    }
+
+    std::string_view data_;
+    InputFormat format_;
+    std::vector<std::size_t> chunks_; // lengths, in file order
+    std::vector<Slot> slots_;         // chunk i goes to slot i % size
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable room_; // a slot was freed, or stop
+    std::condition_variable done_; // a chunk was parsed, or a worker failed
+    std::size_t taken_ = 0;
+    std::size_t begin_ = 0; // offset of chunk taken_
+    std::size_t read_ = 0;
+    std::exception_ptr error_;
+    bool stop_ = false;
+};
+
+template <typename F>
+void for_each_mapped_record(const NameInput& input, F f) {
+    std::string_view data = input.mapped->data();
+    if (input.threads == 1) {
+        // Nothing to overlap: parse straight out of the mapping.
+        JsonlNameParser parser;
+        for (std::size_t begin = 0; begin < data.size();) {
+            std::string_view chunk = data.substr(begin, chunk_length(data, begin));
+            check_utf8(chunk, begin);
+            if (input.format == InputFormat::jsonl) {
+                parser.parse(chunk, f);
+            } else {
+                for_each_line(chunk, [&](std::string_view name) { f(name, std::string_view()); });
+            }
+            begin += chunk.size();
+        }
+        return;
+    }
+    ChunkParser parser(data, input);
+    ParsedChunk chunk;
+    while (parser.next(chunk)) {
+        for (std::size_t i = 0; i < chunk.names.size(); ++i) {
+            f(chunk.names[i], chunk.locales.empty() ? std::string_view() : chunk.locales[i]);
+        }
+    }
+}
+
+// Calls f(name, locale) for every record in the input: each non-empty line
+// without a trailing '\r' for text, the "name" and "locale" members of each
+// record for JSON Lines. Text records have no locale.
+template <typename F>
+void for_each_record(const NameInput& input, F f) {
+    if (input.mapped) {
+        for_each_mapped_record(input, f);
+    } else if (input.format == InputFormat::jsonl) {
+        JsonlNameParser parser;
+        std::function<void(std::string_view, std::string_view)> callback = f;
+        for_each_block(input.stream, [&](std::string_view block) { parser.parse(block, callback); });
+    } else {
+        for_each_block(input.stream, [&](std::string_view block) {
+            for_each_line(block, [&](std::string_view name) { f(name, std::string_view()); });
+        });
+    }
+}
+
+// Sorting orders bare names, so records with a locale are refused rather
+// than greeted with the wrong word.
+template <typename F>
+void for_each_name(const NameInput& input, F f) {
+    for_each_record(input, [&](std::string_view name, std::string_view locale) {
+        if (!locale.empty()) {
+            throw std::runtime_error("--sort cannot keep the locale of records");
+        }
+        f(name);
+    });
+}
+
+constexpr std::size_t job_batch_size = 4096;
+
+void greet_all(const NamesOptions& options, const NameInput& input, Greeter& greeter) {
+    NameArena arena;
+    NameSet seen(arena);
+
+    if (!options.sort) {
+        if (options.memory_limit != 0) {
+            throw std::runtime_error("--memory-limit only applies to --sort");
+        }
+        if (input.format == InputFormat::text) {
+            for_each_name(input, [&](std::string_view name) {
+                if (!options.dedup || seen.insert(name).second) {
+                    greeter.greet(name);
+                }
+            });
+            return;
+        }
+        // Records may carry a locale: they are collected into column
+        // batches, resolved against the catalog and greeted a batch at a
+        // time. Text lines have no locale and skip the copy.
+        GreetingJobs jobs;
+        for_each_record(input, [&](std::string_view name, std::string_view locale) {
+            if (!options.dedup || seen.insert(name).second) {
+                jobs.add(name, locale, greeter.catalog());
+                if (jobs.size() == job_batch_size) {
+                    greeter.greet(jobs);
+                    jobs.clear();
+                }
+            }
+        });
+        greeter.greet(jobs);
+        return;
+    }
+
+    if (options.memory_limit != 0) {
+        ExternalNameSorter sorter(options.memory_limit, options.dedup, options.threads, options.temp_dir,
+                                  options.worker_cpus);
+        for_each_name(input, [&](std::string_view name) { sorter.add(name); });
+        sorter.finish([&](std::string_view name) { greeter.greet(name); });
+        return;
+    }
+
+    // Sorting needs the whole list: intern every name into the arena and
+    // radix sort the references.
+    std::vector<NameRef> refs;
+    for_each_name(input, [&](std::string_view name) {
+        if (!options.dedup) {
+            refs.push_back(arena.add(name));
+        } else if (auto inserted = seen.insert(name); inserted.second) {
+            refs.push_back(inserted.first);
+        }
+    });
+    sort_names(arena, refs, options.threads, options.worker_cpus);
+    for (NameRef ref : refs) {
+        greeter.greet(arena.view(ref));
+    }
+}
+
+} // namespace
+
+void emit_names(const NamesOptions& options, OutputBuffer& out) {
+    NameInput input;
+    input.format = options.input_format;
+    input.threads = std::max(1u, options.threads);
+    input.cpus = options.worker_cpus;
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> closer(nullptr, std::fclose);
+    if (options.path == "-") {
+        input.stream = stdin;
+    } else if (!(input.mapped = MappedFile::open(options.path))) {
+        closer.reset(std::fopen(options.path.c_str(), "rb"));
+        if (!closer) {
+            throw std::runtime_error("cannot open " + options.path);
+        }
+        input.stream = closer.get();
+    }
+    Greeter greeter(options, out);
+    greet_all(options, input, greeter);
+    greeter.finish();
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "cpu_affinity.h"
+#include "output_buffer.h"
+
+enum class OutputFormat {
+    text,   // Hello, <name>
+    jsonl,  // {"greeting":"Hello","name":"<name>"}, plus "locale" if given
+    binary, // length-prefixed records in batches, see frame_format.h
+};
+
+enum class InputFormat {
+    text,  // one name per line
+    jsonl, // JSON Lines records with a "name" and an optional "locale" member
+};
+
+struct NamesOptions {
+    std::string path; // "-" reads stdin
+    InputFormat input_format = InputFormat::text;
+    bool dedup = false;
+    bool sort = false;
+    unsigned threads = 1;
+    // CPUs for the parse and sort threads; empty leaves them unpinned.
+    CpuSet worker_cpus;
+    // With sort: bound on the memory used for names; larger lists are
+    // sorted externally through run files in temp_dir. 0 means unbounded.
+    std::size_t memory_limit = 0;
+    std::string temp_dir;
+    OutputFormat format = OutputFormat::text;
+    // Greeting words by locale added to the built-in ones, see
+    // GreetingCatalog::load().
+    std::string catalog;
+    std::string counts_db;
+    // Report greeting counts, a distinct-name estimate and the top_k most
+    // greeted names on stderr.
+    bool stats = false;
+    std::size_t top_k = 10;
+};
+
+// Personalized mode: "Hello, <name>" for every line of the names file.
+void emit_names(const NamesOptions& options, OutputBuffer& out);
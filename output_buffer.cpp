@@ -0,0 +1,64 @@
+#include "output_buffer.h"
+
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+OutputBuffer::OutputBuffer(std::FILE* file, std::size_t capacity) : file_(file), buffer_(capacity) {}
+
+OutputBuffer::OutputBuffer(Sink& sink, std::size_t capacity) : sink_(&sink), buffer_(capacity) {}
+
+OutputBuffer::~OutputBuffer() {
+    try {
+        flush();
+    } catch (...) {
+    }
+}
+
+void OutputBuffer::append(std::string_view s) {
+    std::memcpy(reserve(s.size()), s.data(), s.size());
+    commit(s.size());
+}
+
+void OutputBuffer::flush() {
+    if (size_ == 0) {
+        return;
+    }
+    std::string_view chunk(buffer_.data(), size_);
+    size_ = 0;
+    try {
+        write_out(chunk);
+    } catch (...) {
+        // What never reached the destination is not reported to the tap.
+        stamps_.clear();
+        throw;
+    }
+    if (tap_ != nullptr) {
+        tap_->write(chunk, stamps_);
+        stamps_.clear();
+    }
+}
+
+void OutputBuffer::write_out(std::string_view data) {
+    if (sink_ != nullptr) {
+        sink_->write(data);
+        return;
+    }
+    if (std::fwrite(data.data(), 1, data.size(), file_) != data.size() || std::fflush(file_) != 0) {
+        throw std::runtime_error("write failed");
+    }
+}
+
+void OutputBuffer::stamp() {
+    std::int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::system_clock::now().time_since_epoch())
+                           .count();
+    stamps_.push_back({now, size_});
+}
+
+void OutputBuffer::grow(std::size_t n) {
+    flush();
+    if (buffer_.size() < n) {
+        buffer_.resize(n);
+    }
+}
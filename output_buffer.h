@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+#include <vector>
+
+// Destination for flushed output other than a plain FILE*.
+class Sink {
+public:
+    virtual ~Sink() = default;
+    virtual void write(std::string_view data) = 0;
+};
+
+// Observer of what an OutputBuffer has written out, told when each part of
+// it was committed.
+class Tap {
+public:
+    // The bytes up to end were complete at time, in ns since the Unix
+    // epoch.
+    struct Stamp {
+        std::int64_t time;
+        std::size_t end;
+    };
+
+    virtual ~Tap() = default;
+    // Called once data has reached the destination; stamps are in commit
+    // order.
+    virtual void write(std::string_view data, const std::vector<Stamp>& stamps) = 0;
+};
+
+// Large write buffer in front of a FILE* or Sink, so each greeting is a
+// memcpy instead of a trip through the iostream machinery.
+class OutputBuffer {
+public:
+    explicit OutputBuffer(std::FILE* file, std::size_t capacity = 1 << 16);
+    explicit OutputBuffer(Sink& sink, std::size_t capacity = 1 << 16);
+    ~OutputBuffer();
+
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    // Returns space for at least n bytes; the caller reports the bytes it
+    // actually used with commit().
+    char* reserve(std::size_t n) {
+        if (buffer_.size() - size_ < n) {
+            grow(n);
+        }
+        return buffer_.data() + size_;
+    }
+
+    void commit(std::size_t n) {
+        size_ += n;
+        if (tap_ != nullptr) {
+            stamp();
+        }
+    }
+
+    void append(std::string_view s);
+    void flush();
+
+    // Also passes every chunk that was written successfully to tap, with
+    // the time of each commit in it.
+    void set_tap(Tap* tap) {
+        tap_ = tap;
+    }
+
+private:
+    void grow(std::size_t n);
+    void stamp();
+    void write_out(std::string_view data);
+
+    std::FILE* file_ = nullptr;
+    Sink* sink_ = nullptr;
+    Tap* tap_ = nullptr;
+    std::vector<char> buffer_;
+    std::size_t size_ = 0;
+    std::vector<Tap::Stamp> stamps_;
+};
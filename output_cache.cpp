@@ -0,0 +1,181 @@
+#include "output_cache.h"
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "file_sync.h"
+
+#ifdef __linux__
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// An entry is the magic, the key length and the key, then the output.
+constexpr char entry_magic[4] = {'H', 'O', 'C', '1'};
+
+std::uint64_t fnv1a(std::string_view s) {
+    std::uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : s) {
+        hash = (hash ^ c) * 1099511628211ull;
+    }
+    return hash;
+}
+
+std::string hex(std::uint64_t value) {
+    static const char digits[] = "0123456789abcdef";
+    std::string s(16, '0');
+    for (int i = 15; i >= 0; --i, value >>= 4) {
+        s[i] = digits[value & 0xf];
+    }
+    return s;
+}
+
+bool copy_stream(std::FILE* in, std::FILE* out) {
+    std::vector<char> buffer(1 << 16);
+    std::size_t n;
+    while ((n = std::fread(buffer.data(), 1, buffer.size(), in)) > 0) {
+        if (std::fwrite(buffer.data(), 1, n, out) != n) {
+            throw std::runtime_error("write failed");
+        }
+    }
+    return std::ferror(in) == 0;
+}
+
+std::FILE* open_entry(const std::string& path) {
+#ifdef __linux__
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+    std::FILE* file = fdopen(fd, "rb");
+    if (file == nullptr) {
+        close(fd);
+    }
+    return file;
+#else
+    return std::fopen(path.c_str(), "rb");
+#endif
+}
+
+#ifdef __linux__
+// Sends in from offset start to the end. Returns false if sendfile is not
+// usable for this pair of descriptors and nothing has been written yet.
+bool send_file(int in, int out, off_t start) {
+    struct stat st;
+    if (fstat(in, &st) != 0) {
+        return false;
+    }
+    off_t offset = start;
+    while (offset < st.st_size) {
+        ssize_t n = sendfile(out, in, &offset, static_cast<std::size_t>(st.st_size - offset));
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN) {
+                continue;
+            }
+            if (offset == start && (errno == EINVAL || errno == ENOSYS)) {
+                return false;
+            }
+            throw std::runtime_error("sendfile failed");
+        }
+        if (n == 0) {
+            break;
+        }
+    }
+    return true;
+}
+#endif
+
+} // namespace
+
+OutputCache::OutputCache(const std::string& dir, std::string_view key)
+    : dir_(dir), key_(key), path_(dir + "/hello-" + hex(fnv1a(key)) + ".out") {}
+
+OutputCache::~OutputCache() {
+    if (temp_ != nullptr) {
+        std::fclose(temp_);
+        std::remove(temp_path_.c_str());
+    }
+}
+
+bool OutputCache::read_key(std::FILE* in) const {
+    char magic[sizeof(entry_magic)];
+    std::uint64_t size;
+    if (std::fread(magic, 1, sizeof(magic), in) != sizeof(magic) ||
+        std::memcmp(magic, entry_magic, sizeof(magic)) != 0 || std::fread(&size, 1, sizeof(size), in) != sizeof(size) ||
+        size != key_.size()) {
+        return false;
+    }
+    std::string key(key_.size(), '\0');
+    return std::fread(&key[0], 1, key.size(), in) == key.size() && key == key_;
+}
+
+bool OutputCache::serve(std::FILE* out) const {
+    std::FILE* in = open_entry(path_);
+    if (in == nullptr) {
+        return false;
+    }
+    if (!read_key(in)) {
+        std::fclose(in);
+        return false;
+    }
+    std::fflush(out);
+#ifdef __linux__
+    off_t start = static_cast<off_t>(sizeof(entry_magic) + sizeof(std::uint64_t) + key_.size());
+    bool sent = send_file(fileno(in), fileno(out), start);
+    if (sent) {
+        std::fclose(in);
+        return true;
+    }
+#endif
+    bool ok = copy_stream(in, out);
+    std::fclose(in);
+    if (!ok || std::fflush(out) != 0) {
+        throw std::runtime_error("failed to read cache file " + path_);
+    }
+    return true;
+}
+
+std::FILE* OutputCache::begin_store() {
+    temp_path_ = path_ + ".tmp." + hex(std::random_device{}());
+    temp_ = std::fopen(temp_path_.c_str(), "wb");
+    if (temp_ == nullptr) {
+        throw std::runtime_error("cannot create cache file " + temp_path_);
+    }
+    std::uint64_t size = key_.size();
+    if (std::fwrite(entry_magic, 1, sizeof(entry_magic), temp_) != sizeof(entry_magic) ||
+        std::fwrite(&size, 1, sizeof(size), temp_) != sizeof(size) ||
+        std::fwrite(key_.data(), 1, key_.size(), temp_) != key_.size()) {
+        throw std::runtime_error("cannot write cache file " + temp_path_);
+    }
+    return temp_;
+}
+
+void OutputCache::commit() {
+    // Synced before the rename, so a crash cannot publish a truncated entry
+    // that later hits would serve.
+    bool ok = sync_file(temp_);
+    ok = std::fclose(temp_) == 0 && ok;
+    temp_ = nullptr;
+    if (ok && std::rename(temp_path_.c_str(), path_.c_str()) == 0) {
+        if (!sync_directory(dir_)) {
+            throw std::runtime_error("cannot sync " + dir_);
+        }
+        return;
+    }
+    std::remove(temp_path_.c_str());
+    // rename() does not replace an existing file on Windows; another process
+    // filling the same entry first is fine.
+    std::FILE* existing = ok ? std::fopen(path_.c_str(), "rb") : nullptr;
+    if (existing == nullptr) {
+        throw std::runtime_error("cannot write cache file " + path_);
+    }
+    std::fclose(existing);
+}
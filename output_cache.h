@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+// On-disk cache of rendered output. Each argument set maps to one file in
+// the cache directory; a hit is streamed to stdout without generating
+// anything. Files are named by a hash of the key and start with the full
+// key, so an entry left by a colliding key is a miss.
+class OutputCache {
+public:
+    OutputCache(const std::string& dir, std::string_view key);
+    ~OutputCache();
+
+    OutputCache(const OutputCache&) = delete;
+    OutputCache& operator=(const OutputCache&) = delete;
+
+    // Streams the cached output to out. Returns false on a cache miss.
+    bool serve(std::FILE* out) const;
+
+    // Opens a temporary file to render into; commit() publishes it
+    // atomically under the final name.
+    std::FILE* begin_store();
+    void commit();
+
+private:
+    // Reads the key at the start of an entry; false if it is not key_.
+    bool read_key(std::FILE* in) const;
+
+    std::string dir_;
+    std::string key_;
+    std::string path_;
+    std::string temp_path_;
+    std::FILE* temp_ = nullptr;
+};
@@ -0,0 +1,49 @@
+#include "qsbr.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+Qsbr::Qsbr(std::size_t max_readers) : slots_(new Slot[max_readers]), max_readers_(max_readers) {}
+
+std::size_t Qsbr::add_reader() {
+    std::size_t reader = readers_.fetch_add(1);
+    if (reader >= max_readers_) {
+        throw std::length_error("too many QSBR readers");
+    }
+    return reader;
+}
+
+void Qsbr::quiescent(std::size_t reader) {
+    // Reads before this point must not move past the store, nor reads
+    // after it move before.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    slots_[reader].seen.store(epoch_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void Qsbr::offline(std::size_t reader) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    slots_[reader].seen.store(0, std::memory_order_release);
+}
+
+void Qsbr::online(std::size_t reader) {
+    slots_[reader].seen.store(epoch_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void Qsbr::synchronize() {
+    std::uint64_t target = epoch_.fetch_add(1, std::memory_order_seq_cst) + 1;
+    std::size_t readers = std::min(readers_.load(), max_readers_);
+    for (std::size_t i = 0; i < readers; ++i) {
+        for (;;) {
+            std::uint64_t seen = slots_[i].seen.load(std::memory_order_acquire);
+            if (seen == 0 || seen >= target) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
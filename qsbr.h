@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Quiescent-state-based reclamation for read-mostly data. Readers take no
+// locks and write nothing per read: each registered reader thread reports
+// a quiescent state between reads, when it holds no references. A writer
+// that has unpublished an object calls synchronize(), which returns once
+// every reader has passed a quiescent state, and may then free it.
+class Qsbr {
+public:
+    explicit Qsbr(std::size_t max_readers);
+
+    // Returns the reader's slot. Readers start offline.
+    std::size_t add_reader();
+
+    void quiescent(std::size_t reader);
+    // An offline reader holds no references and is not waited for, so a
+    // reader goes offline before it blocks.
+    void offline(std::size_t reader);
+    void online(std::size_t reader);
+
+    void synchronize();
+
+private:
+    struct alignas(64) Slot {
+        // Last epoch the reader has seen; 0 while offline.
+        std::atomic<std::uint64_t> seen{0};
+    };
+
+    std::atomic<std::uint64_t> epoch_{1};
+    std::unique_ptr<Slot[]> slots_;
+    std::size_t max_readers_;
+    std::atomic<std::size_t> readers_{0};
+};
@@ -0,0 +1,128 @@
+#include "scheduler.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+#include "greeting.h"
+#include "timing_wheel.h"
+
+#ifdef __linux__
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Millisecond ticks since the clock was started, and a way to sleep until
+// a given one.
+class TickClock {
+public:
+    TickClock() : start_(Clock::now()) {
+#ifdef __linux__
+        fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+        if (fd_ < 0) {
+            throw std::runtime_error("timerfd_create failed");
+        }
+#endif
+    }
+
+    ~TickClock() {
+#ifdef __linux__
+        close(fd_);
+#endif
+    }
+
+    TickClock(const TickClock&) = delete;
+    TickClock& operator=(const TickClock&) = delete;
+
+    // Blocks until tick has been reached and returns the current tick.
+    std::uint64_t wait_until(std::uint64_t tick) {
+        Clock::duration remaining = start_ + std::chrono::milliseconds(tick) - Clock::now();
+        if (remaining <= Clock::duration::zero()) {
+            return elapsed();
+        }
+#ifdef __linux__
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(remaining).count() + 1;
+        itimerspec spec{{0, 0}, {static_cast<time_t>(ns / 1000000000), static_cast<long>(ns % 1000000000)}};
+        if (timerfd_settime(fd_, 0, &spec, nullptr) != 0) {
+            throw std::runtime_error("timerfd_settime failed");
+        }
+        std::uint64_t expirations;
+        for (;;) {
+            ssize_t n = read(fd_, &expirations, sizeof(expirations));
+            if (n == static_cast<ssize_t>(sizeof(expirations))) {
+                break;
+            }
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("cannot read timerfd");
+        }
+#else
+        std::this_thread::sleep_until(start_ + std::chrono::milliseconds(tick));
+#endif
+        return elapsed();
+    }
+
+private:
+    std::uint64_t elapsed() const {
+        return static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start_).count());
+    }
+
+    Clock::time_point start_;
+#ifdef __linux__
+    int fd_;
+#endif
+};
+
+} // namespace
+
+std::vector<ScheduledGreeting> read_schedule(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("cannot open " + path);
+    }
+    std::vector<ScheduledGreeting> schedule;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        char* end = nullptr;
+        unsigned long long delay = std::strtoull(line.c_str(), &end, 10);
+        if (end == line.c_str() || (*end != ' ' && *end != '\t')) {
+            throw std::runtime_error("invalid schedule line: " + line);
+        }
+        schedule.push_back({delay, std::string(end + 1)});
+    }
+    return schedule;
+}
+
+void run_schedule(const std::vector<ScheduledGreeting>& schedule, OutputBuffer& out) {
+    TickClock clock;
+    TimingWheel wheel;
+    for (std::size_t i = 0; i < schedule.size(); ++i) {
+        wheel.insert(schedule[i].delay_ms, i);
+    }
+    std::vector<std::uint64_t> expired;
+    while (wheel.size() != 0) {
+        wheel.advance(clock.wait_until(wheel.next_expiry()), expired);
+        for (std::uint64_t index : expired) {
+            std::string_view name = schedule[index].name;
+            char* end = write_greeting(out.reserve(greeting_size(name) + 1), name);
+            *end = '\n';
+            out.commit(greeting_size(name) + 1);
+        }
+        if (!expired.empty()) {
+            out.flush();
+            expired.clear();
+        }
+    }
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "output_buffer.h"
+
+struct ScheduledGreeting {
+    std::uint64_t delay_ms;
+    std::string name;
+};
+
+// Reads "<delay in ms> <name>" lines.
+std::vector<ScheduledGreeting> read_schedule(const std::string& path);
+
+// Emits each greeting once its delay has passed, measured from the start of
+// the call. All timers live in one timing wheel with 1 ms ticks; a single
+// timerfd on Linux is armed for the wheel's next expiry, so the process only
+// wakes when there is work. Greetings that expire on the same tick are
+// written and flushed together.
+void run_schedule(const std::vector<ScheduledGreeting>& schedule, OutputBuffer& out);
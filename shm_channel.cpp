@@ -0,0 +1,324 @@
+#include "shm_channel.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "greeting.h"
+
+namespace shm_channel {
+
+namespace {
+
+// The segment is shared between processes, so the futex calls must not use
+// the private variants.
+void futex_wait(std::atomic<std::uint32_t>& word, std::uint32_t expected, long timeout_ns) {
+    timespec timeout{0, timeout_ns};
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAIT, expected, &timeout, nullptr, 0);
+}
+
+// A pid that was reused by another process counts as alive; the channel is
+// then only reclaimed once that process exits too.
+bool process_alive(std::uint32_t pid) {
+    return kill(static_cast<pid_t>(pid), 0) == 0 || errno != ESRCH;
+}
+
+void futex_wake(std::atomic<std::uint32_t>& word) {
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+void copy_in(char* data, std::uint64_t position, const void* src, std::size_t size) {
+    std::size_t offset = position % ring_capacity;
+    std::size_t first = std::min(size, ring_capacity - offset);
+    std::memcpy(data + offset, src, first);
+    std::memcpy(data, static_cast<const char*>(src) + first, size - first);
+}
+
+void copy_out(const char* data, std::uint64_t position, void* dst, std::size_t size) {
+    std::size_t offset = position % ring_capacity;
+    std::size_t first = std::min(size, ring_capacity - offset);
+    std::memcpy(dst, data + offset, first);
+    std::memcpy(static_cast<char*>(dst) + first, data, size - first);
+}
+
+void notify(Ring& ring) {
+    ring.epoch.fetch_add(1, std::memory_order_seq_cst);
+    if (ring.waiters.load(std::memory_order_seq_cst) != 0) {
+        futex_wake(ring.epoch);
+    }
+}
+
+void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// Spins briefly, then sleeps until the ring has data or the timeout passes.
+void wait_for_data(Ring& ring, long timeout_ns) {
+    for (int i = 0; i < 256; ++i) {
+        if (!ring.empty()) {
+            return;
+        }
+    }
+    std::uint32_t epoch = ring.epoch.load(std::memory_order_seq_cst);
+    ring.waiters.fetch_add(1, std::memory_order_seq_cst);
+    if (ring.empty()) {
+        futex_wait(ring.epoch, epoch, timeout_ns);
+    }
+    ring.waiters.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+Segment* map_segment(const std::string& name, bool create) {
+    int fd = create ? shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600) : shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        throw std::runtime_error("cannot open shared memory " + name);
+    }
+    if (create && ftruncate(fd, sizeof(Segment)) != 0) {
+        close(fd);
+        shm_unlink(name.c_str());
+        throw std::runtime_error("cannot size shared memory " + name);
+    }
+    void* mapping = mmap(nullptr, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        if (create) {
+            shm_unlink(name.c_str());
+        }
+        throw std::runtime_error("cannot map shared memory " + name);
+    }
+    return static_cast<Segment*>(mapping);
+}
+
+} // namespace
+
+bool Ring::push(std::string_view message) {
+    if (!has_room(message.size())) {
+        return false;
+    }
+    std::uint64_t position = head.load(std::memory_order_relaxed);
+    std::uint32_t length = static_cast<std::uint32_t>(message.size());
+    copy_in(data, position, &length, sizeof(length));
+    copy_in(data, position + sizeof(length), message.data(), message.size());
+    head.store(position + sizeof(length) + message.size(), std::memory_order_release);
+    notify(*this);
+    return true;
+}
+
+bool Ring::pop(std::string& message) {
+    std::uint64_t position = tail.load(std::memory_order_relaxed);
+    if (head.load(std::memory_order_acquire) == position) {
+        return false;
+    }
+    std::uint32_t length;
+    copy_out(data, position, &length, sizeof(length));
+    message.resize(length);
+    copy_out(data, position + sizeof(length), &message[0], length);
+    tail.store(position + sizeof(length) + length, std::memory_order_release);
+    return true;
+}
+
+} // namespace shm_channel
+
+using namespace shm_channel;
+
+ShmGreetingServer::ShmGreetingServer(const std::string& name, std::unique_ptr<GreetingCatalog> catalog)
+    : name_(name), catalog_(catalog ? catalog.release() : new GreetingCatalog), reader_(qsbr_.add_reader()),
+      counter_slot_(counters_.add_thread()) {
+    shm_unlink(name.c_str());
+    segment_ = new (map_segment(name, true)) Segment;
+    segment_->version = version;
+    segment_->server_pid.store(static_cast<std::uint32_t>(getpid()), std::memory_order_relaxed);
+    segment_->magic.store(magic, std::memory_order_release);
+}
+
+ShmGreetingServer::~ShmGreetingServer() {
+    // Clients still waiting on a response see this and give up.
+    segment_->magic.store(0, std::memory_order_release);
+    shm_unlink(name_.c_str());
+    munmap(segment_, sizeof(Segment));
+    delete catalog_.load();
+}
+
+void ShmGreetingServer::set_catalog(std::unique_ptr<GreetingCatalog> catalog) {
+    std::lock_guard<std::mutex> lock(publish_mutex_);
+    std::unique_ptr<GreetingCatalog> old(catalog_.exchange(catalog.release(), std::memory_order_acq_rel));
+    qsbr_.synchronize();
+}
+
+std::size_t ShmGreetingServer::poll() {
+    std::size_t handled = 0;
+    std::string request;
+    std::string response;
+    const GreetingCatalog* catalog = catalog_.load(std::memory_order_acquire);
+    for (Channel& channel : segment_->channels) {
+        if (channel.state.load(std::memory_order_acquire) != channel_connected) {
+            continue;
+        }
+        // A request is only taken once its response is sure to fit, so a
+        // slow client just leaves its requests queued.
+        while (!channel.requests.empty() && channel.responses.has_room(max_message)) {
+            channel.requests.pop(request);
+            response.clear();
+            std::size_t locale_size = request.empty() ? 0 : static_cast<unsigned char>(request[0]);
+            if (!request.empty() && 1 + locale_size <= request.size()) {
+                std::string_view locale(request.data() + 1, locale_size);
+                std::string_view name(request.data() + 1 + locale_size, request.size() - 1 - locale_size);
+                std::string_view word = catalog->word(locale.empty() ? 0 : catalog->find(locale));
+                response.resize(greeting_size(word, name));
+                write_greeting(&response[0], word, name);
+                counters_.add(counter_slot_, response.size());
+                if (greeted_) {
+                    greeted_(name, response.size());
+                }
+            }
+            channel.responses.push(response);
+            ++handled;
+        }
+    }
+    return handled;
+}
+
+void ShmGreetingServer::reclaim_dead_clients() {
+    for (Channel& channel : segment_->channels) {
+        if (channel.state.load(std::memory_order_acquire) != channel_connected) {
+            continue;
+        }
+        std::uint32_t owner = channel.owner_pid.load(std::memory_order_acquire);
+        if (owner == 0 || process_alive(owner)) {
+            continue;
+        }
+        // Both ends are now the server's: drop the unanswered requests and
+        // the responses nobody will read, then hand the channel out again.
+        channel.requests.tail.store(channel.requests.head.load(std::memory_order_acquire), std::memory_order_release);
+        channel.responses.tail.store(channel.responses.head.load(std::memory_order_relaxed),
+                                     std::memory_order_release);
+        channel.responses.waiters.store(0, std::memory_order_relaxed);
+        channel.owner_pid.store(0, std::memory_order_relaxed);
+        channel.state.store(channel_free, std::memory_order_release);
+    }
+}
+
+void ShmGreetingServer::run(const std::atomic<bool>& stop, bool busy_poll) {
+    qsbr_.online(reader_);
+    unsigned idle = 0;
+    unsigned rounds = 0;
+    auto next_reclaim = std::chrono::steady_clock::now();
+    while (!stop.load(std::memory_order_relaxed)) {
+        // Dead clients are looked for every 100 ms, busy or not; the clock
+        // is only read every 1024 rounds.
+        if (++rounds % 1024 == 0 && std::chrono::steady_clock::now() >= next_reclaim) {
+            reclaim_dead_clients();
+            next_reclaim = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+        }
+        std::size_t handled = poll();
+        qsbr_.quiescent(reader_);
+        if (handled != 0) {
+            idle = 0;
+            continue;
+        }
+        if (busy_poll) {
+            // Clients never see server_waiting set, so they skip the wake
+            // call too. The yield lets a thread sharing this CPU run.
+            if (++idle % 256 == 0) {
+                std::this_thread::yield();
+            } else {
+                cpu_relax();
+            }
+            continue;
+        }
+        if (++idle < 1024) {
+            continue;
+        }
+        std::uint32_t bell = segment_->doorbell.load(std::memory_order_seq_cst);
+        segment_->server_waiting.store(1, std::memory_order_seq_cst);
+        if (poll() == 0) {
+            qsbr_.offline(reader_);
+            futex_wait(segment_->doorbell, bell, 100 * 1000 * 1000);
+            qsbr_.online(reader_);
+        } else {
+            qsbr_.quiescent(reader_);
+        }
+        segment_->server_waiting.store(0, std::memory_order_relaxed);
+        idle = 0;
+    }
+    qsbr_.offline(reader_);
+}
+
+ShmGreetingClient::ShmGreetingClient(const std::string& name) {
+    segment_ = map_segment(name, false);
+    if (segment_->magic.load(std::memory_order_acquire) != magic || segment_->version != version) {
+        munmap(segment_, sizeof(Segment));
+        throw std::runtime_error("shared memory " + name + " is not a greeting service");
+    }
+    for (Channel& channel : segment_->channels) {
+        std::uint32_t state = channel_free;
+        if (channel.state.compare_exchange_strong(state, channel_connected, std::memory_order_acq_rel)) {
+            channel.owner_pid.store(static_cast<std::uint32_t>(getpid()), std::memory_order_release);
+            channel_ = &channel;
+            return;
+        }
+    }
+    munmap(segment_, sizeof(Segment));
+    throw std::runtime_error("greeting service " + name + " has no free channel");
+}
+
+ShmGreetingClient::~ShmGreetingClient() {
+    channel_->owner_pid.store(0, std::memory_order_relaxed);
+    channel_->state.store(channel_free, std::memory_order_release);
+    munmap(segment_, sizeof(Segment));
+}
+
+std::string ShmGreetingClient::greet(std::string_view name, std::string_view locale) {
+    if (locale.size() > 255 || 1 + locale.size() + name.size() > max_message ||
+        GreetingCatalog::max_word_size + 2 + name.size() > max_message) {
+        throw std::length_error("name too long for the shared-memory channel");
+    }
+    std::string request;
+    request.reserve(1 + locale.size() + name.size());
+    request.push_back(static_cast<char>(locale.size()));
+    request.append(locale.data(), locale.size()).append(name.data(), name.size());
+    for (unsigned spins = 1; !channel_->requests.push(request); ++spins) {
+        if (spins % 1024 == 0) {
+            check_server();
+        }
+        std::this_thread::yield();
+    }
+    segment_->doorbell.fetch_add(1, std::memory_order_seq_cst);
+    if (segment_->server_waiting.load(std::memory_order_seq_cst) != 0) {
+        futex_wake(segment_->doorbell);
+    }
+    std::string response;
+    while (!channel_->responses.pop(response)) {
+        wait_for_data(channel_->responses, 100 * 1000 * 1000);
+        if (channel_->responses.empty()) {
+            check_server();
+        }
+    }
+    if (response.empty()) {
+        throw std::runtime_error("greeting service rejected the request");
+    }
+    return response;
+}
+
+void ShmGreetingClient::check_server() const {
+    if (segment_->magic.load(std::memory_order_acquire) != magic ||
+        !process_alive(segment_->server_pid.load(std::memory_order_relaxed))) {
+        throw std::runtime_error("greeting service stopped");
+    }
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "greeting_jobs.h"
+#include "qsbr.h"
+#include "thread_counters.h"
+
+// Same-host transport for the greeting service: one shared-memory segment
+// holding a fixed table of client channels. Each channel is a pair of
+// single-producer/single-consumer byte rings (requests and responses);
+// sleeping sides are woken with futexes, so an idle service costs nothing
+// and a busy one never enters the kernel.
+namespace shm_channel {
+
+constexpr std::uint32_t magic = 0x4843484e; // "HCHN"
+constexpr std::uint32_t version = 3;
+constexpr std::size_t cache_line = 64;
+constexpr std::size_t max_clients = 64;
+constexpr std::size_t ring_capacity = 1 << 16;
+constexpr std::size_t max_message = ring_capacity / 4;
+
+// Records are a 32-bit length followed by the payload, wrapping around the
+// end of data. head is only written by the producer, tail by the consumer.
+// A request payload is the length of the locale in one byte, the locale
+// and the name; an empty response reports a malformed request.
+struct Ring {
+    alignas(cache_line) std::atomic<std::uint64_t> head;
+    alignas(cache_line) std::atomic<std::uint64_t> tail;
+    // Event count for the consumer: bumped on every push, waited on with a
+    // futex when the ring is empty.
+    alignas(cache_line) std::atomic<std::uint32_t> epoch;
+    std::atomic<std::uint32_t> waiters;
+    alignas(cache_line) char data[ring_capacity];
+
+    bool push(std::string_view message);
+    bool pop(std::string& message);
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_relaxed);
+    }
+    // Whether a record with a payload of size bytes fits.
+    bool has_room(std::size_t size) const {
+        return ring_capacity - (head.load(std::memory_order_relaxed) - tail.load(std::memory_order_acquire)) >=
+               sizeof(std::uint32_t) + size;
+    }
+};
+
+enum ChannelState : std::uint32_t { channel_free = 0, channel_connected = 1 };
+
+// A connected channel whose owner_pid no longer exists belongs to a client
+// that died without disconnecting; the server drains and frees it.
+struct Channel {
+    alignas(cache_line) std::atomic<std::uint32_t> state;
+    // Zero until the client that claimed the channel has recorded itself.
+    std::atomic<std::uint32_t> owner_pid;
+    Ring requests;
+    Ring responses;
+};
+
+struct Segment {
+    std::atomic<std::uint32_t> magic;
+    std::uint32_t version;
+    std::atomic<std::uint32_t> server_pid;
+    // Rung by clients after pushing a request; the server sleeps on it.
+    alignas(cache_line) std::atomic<std::uint32_t> doorbell;
+    std::atomic<std::uint32_t> server_waiting;
+    Channel channels[max_clients];
+};
+
+} // namespace shm_channel
+
+// Serves greetings to ShmGreetingClient instances on the same host.
+class ShmGreetingServer {
+public:
+    // Without a catalog the built-in words are used.
+    explicit ShmGreetingServer(const std::string& name, std::unique_ptr<GreetingCatalog> catalog = nullptr);
+    ~ShmGreetingServer();
+
+    ShmGreetingServer(const ShmGreetingServer&) = delete;
+    ShmGreetingServer& operator=(const ShmGreetingServer&) = delete;
+
+    // Handles requests until stop is set. The flag is checked at least every
+    // 100 ms while idle. With busy_poll the server never sleeps on the
+    // doorbell: it keeps polling the channels, only yielding its CPU now and
+    // then, which spends a core to take the futex wakeup out of the latency.
+    void run(const std::atomic<bool>& stop, bool busy_poll = false);
+
+    // Publishes catalog for the requests that follow, from any thread,
+    // without pausing run(). Returns once no request in flight can still
+    // use the previous catalog, which is then freed.
+    void set_catalog(std::unique_ptr<GreetingCatalog> catalog);
+
+    // Calls greeted with each name served and the size of its greeting, on
+    // the thread in run(); for the --stats sketches. Set before run().
+    void on_greeted(std::function<void(std::string_view, std::size_t)> greeted) {
+        greeted_ = std::move(greeted);
+    }
+
+    // Greetings served so far and their bytes, from any thread.
+    ThreadCounters::Totals served() const {
+        return counters_.read();
+    }
+
+private:
+    // Processes pending requests on every channel; returns how many.
+    std::size_t poll();
+    // Frees the channels of clients that exited without disconnecting.
+    void reclaim_dead_clients();
+
+    std::string name_;
+    shm_channel::Segment* segment_ = nullptr;
+    // Read by run() without locking; replaced by set_catalog() and
+    // reclaimed once run() has passed a quiescent state.
+    std::atomic<GreetingCatalog*> catalog_;
+    Qsbr qsbr_{1};
+    std::size_t reader_;
+    std::mutex publish_mutex_;
+    ThreadCounters counters_{1};
+    std::size_t counter_slot_;
+    std::function<void(std::string_view, std::size_t)> greeted_;
+};
+
+class ShmGreetingClient {
+public:
+    explicit ShmGreetingClient(const std::string& name);
+    ~ShmGreetingClient();
+
+    ShmGreetingClient(const ShmGreetingClient&) = delete;
+    ShmGreetingClient& operator=(const ShmGreetingClient&) = delete;
+
+    // Round trip to the server: "Hello, <name>", with the word of locale
+    // in the server's catalog. Throws std::runtime_error if the server
+    // exits or stops before answering.
+    std::string greet(std::string_view name, std::string_view locale = std::string_view());
+
+private:
+    // Throws once the server is gone.
+    void check_server() const;
+
+    shm_channel::Segment* segment_ = nullptr;
+    shm_channel::Channel* channel_ = nullptr;
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Layout of the shared-memory broadcast ring written by `hello --shm NAME`
+// and read through ShmRingReader. One publisher, any number of readers.
+//
+// Message n lives in slot n % slot_count. Each slot carries a sequence
+// word: 2n + 1 while message n is being written, 2n + 2 once it is
+// complete. A reader copies the payload and re-checks the sequence word;
+// if it changed, the publisher lapped the reader and the copy is discarded.
+namespace shm_ring {
+
+constexpr std::uint32_t magic = 0x48524e47; // "HRNG"
+constexpr std::uint32_t version = 1;
+constexpr std::size_t cache_line = 64;
+// Geometry limits, which also keep mapping_size() from overflowing.
+constexpr std::uint64_t max_slots = 1 << 16;
+constexpr std::uint64_t max_slot_size = 1 << 24;
+
+struct Header {
+    std::atomic<std::uint32_t> magic; // written last, once the geometry is valid
+    std::uint32_t version;
+    std::uint64_t slot_count;
+    std::uint64_t slot_size; // payload bytes per slot
+    std::uint64_t slot_stride;
+    alignas(cache_line) std::atomic<std::uint64_t> head; // next message number
+    std::atomic<std::uint32_t> closed;
+};
+
+struct Slot {
+    std::atomic<std::uint64_t> sequence;
+    std::uint32_t length;
+    // payload follows
+};
+
+inline std::size_t slot_stride(std::size_t slot_size) {
+    std::size_t bytes = sizeof(Slot) + slot_size;
+    return (bytes + cache_line - 1) / cache_line * cache_line;
+}
+
+inline std::size_t header_size() {
+    return (sizeof(Header) + cache_line - 1) / cache_line * cache_line;
+}
+
+inline bool valid_geometry(std::uint64_t slot_count, std::uint64_t slot_size) {
+    return slot_count >= 1 && slot_count <= max_slots && slot_size >= 1 && slot_size <= max_slot_size;
+}
+
+// Only meaningful for a valid geometry.
+inline std::size_t mapping_size(std::size_t slot_count, std::size_t slot_size) {
+    return header_size() + slot_count * slot_stride(slot_size);
+}
+
+inline Slot* slot_at(Header* header, std::uint64_t n) {
+    char* base = reinterpret_cast<char*>(header) + header_size();
+    return reinterpret_cast<Slot*>(base + (n % header->slot_count) * header->slot_stride);
+}
+
+inline char* payload(Slot* slot) {
+    return reinterpret_cast<char*>(slot + 1);
+}
+
+} // namespace shm_ring
@@ -0,0 +1,91 @@
+#include "shm_ring_reader.h"
+
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ShmRingReader::ShmRingReader(const std::string& name, bool from_oldest) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        throw std::runtime_error("cannot open shared memory " + name);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < shm_ring::header_size()) {
+        ::close(fd);
+        throw std::runtime_error("shared memory " + name + " is not a greeting ring");
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+    void* mapping = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("cannot map shared memory " + name);
+    }
+    header_ = static_cast<shm_ring::Header*>(mapping);
+    if (header_->magic.load(std::memory_order_acquire) != shm_ring::magic || header_->version != shm_ring::version ||
+        !shm_ring::valid_geometry(header_->slot_count, header_->slot_size) ||
+        shm_ring::mapping_size(header_->slot_count, header_->slot_size) > size_) {
+        munmap(mapping, size_);
+        throw std::runtime_error("shared memory " + name + " is not a greeting ring");
+    }
+    next_ = header_->head.load(std::memory_order_acquire);
+    if (from_oldest) {
+        next_ = next_ > header_->slot_count ? next_ - header_->slot_count : 0;
+    }
+}
+
+ShmRingReader::~ShmRingReader() {
+    munmap(header_, size_);
+}
+
+ShmRingReader::Status ShmRingReader::read(std::string& out) {
+    for (;;) {
+        // Check closed before head, so a close seen here implies every
+        // message before it is visible.
+        bool closed = header_->closed.load(std::memory_order_acquire) != 0;
+        std::uint64_t head = header_->head.load(std::memory_order_acquire);
+        if (next_ >= head) {
+            return closed ? Status::closed : Status::empty;
+        }
+        if (head - next_ > header_->slot_count) {
+            lost_ += head - next_ - header_->slot_count;
+            next_ = head - header_->slot_count;
+        }
+
+        shm_ring::Slot* slot = shm_ring::slot_at(header_, next_);
+        std::uint64_t expected = 2 * next_ + 2;
+        std::uint64_t before = slot->sequence.load(std::memory_order_acquire);
+        if (before == expected) {
+            std::uint32_t length = slot->length;
+            if (length <= header_->slot_size) {
+                out.assign(shm_ring::payload(slot), length);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot->sequence.load(std::memory_order_relaxed) == expected && length <= header_->slot_size) {
+                ++next_;
+                return Status::message;
+            }
+        }
+        // The publisher has moved on to a later lap of this slot; skip ahead
+        // and try again with the oldest message still available.
+        ++lost_;
+        ++next_;
+    }
+}
+
+ShmRingReader::Status ShmRingReader::read_wait(std::string& out) {
+    unsigned spins = 0;
+    Status status;
+    while ((status = read(out)) == Status::empty) {
+        if (++spins < 64) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+    return status;
+}
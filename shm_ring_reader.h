@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "shm_ring.h"
+
+// Reader side of the shared-memory broadcast ring published by
+// `hello --shm NAME`. Readers never write to the segment, so any number of
+// them can follow the same publisher.
+class ShmRingReader {
+public:
+    enum class Status {
+        message, // out holds the next message
+        empty,   // nothing new yet
+        closed,  // publisher finished and everything was read
+    };
+
+    // Attaches to the ring. By default, reading starts with the next message
+    // published; from_oldest starts with the oldest one still in the ring.
+    explicit ShmRingReader(const std::string& name, bool from_oldest = false);
+    ~ShmRingReader();
+
+    ShmRingReader(const ShmRingReader&) = delete;
+    ShmRingReader& operator=(const ShmRingReader&) = delete;
+
+    Status read(std::string& out);
+
+    // Like read(), but waits for a message instead of returning empty.
+    Status read_wait(std::string& out);
+
+    // Messages that were overwritten before this reader got to them.
+    std::uint64_t lost() const {
+        return lost_;
+    }
+
+private:
+    shm_ring::Header* header_ = nullptr;
+    std::size_t size_ = 0;
+    std::uint64_t next_ = 0;
+    std::uint64_t lost_ = 0;
+};
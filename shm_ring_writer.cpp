@@ -0,0 +1,80 @@
+#include "shm_ring_writer.h"
+
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+ShmRingWriter::ShmRingWriter(const std::string& name, std::size_t slot_count, std::size_t slot_size) {
+    if (!shm_ring::valid_geometry(slot_count, slot_size)) {
+        throw std::runtime_error("shared memory ring needs 1 to " + std::to_string(shm_ring::max_slots) +
+                                 " slots of 1 to " + std::to_string(shm_ring::max_slot_size) + " bytes");
+    }
+    size_ = shm_ring::mapping_size(slot_count, slot_size);
+    // Start from a fresh segment so a previous run with another geometry
+    // cannot leave readers looking at stale slots.
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("cannot create shared memory " + name);
+    }
+    if (ftruncate(fd, static_cast<off_t>(size_)) != 0) {
+        ::close(fd);
+        shm_unlink(name.c_str());
+        throw std::runtime_error("cannot size shared memory " + name);
+    }
+    void* mapping = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        throw std::runtime_error("cannot map shared memory " + name);
+    }
+    // The fresh segment is zero-filled, which is a valid state for every
+    // atomic in it; only the geometry is filled in before publishing magic.
+    header_ = new (mapping) shm_ring::Header;
+    header_->version = shm_ring::version;
+    header_->slot_count = slot_count;
+    header_->slot_size = slot_size;
+    header_->slot_stride = shm_ring::slot_stride(slot_size);
+    header_->head.store(0, std::memory_order_relaxed);
+    header_->closed.store(0, std::memory_order_relaxed);
+    header_->magic.store(shm_ring::magic, std::memory_order_release);
+}
+
+ShmRingWriter::~ShmRingWriter() {
+    if (header_ != nullptr) {
+        close();
+        munmap(header_, size_);
+    }
+}
+
+void ShmRingWriter::write(std::string_view data) {
+    std::size_t limit = header_->slot_size;
+    while (!data.empty()) {
+        std::size_t n = data.size();
+        if (n > limit) {
+            std::size_t newline = data.rfind('\n', limit - 1);
+            n = newline == std::string_view::npos ? limit : newline + 1;
+        }
+        publish(data.substr(0, n));
+        data.remove_prefix(n);
+    }
+}
+
+void ShmRingWriter::publish(std::string_view message) {
+    shm_ring::Slot* slot = shm_ring::slot_at(header_, next_);
+    slot->sequence.store(2 * next_ + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot->length = static_cast<std::uint32_t>(message.size());
+    std::memcpy(shm_ring::payload(slot), message.data(), message.size());
+    slot->sequence.store(2 * next_ + 2, std::memory_order_release);
+    header_->head.store(++next_, std::memory_order_release);
+}
+
+void ShmRingWriter::close() {
+    header_->closed.store(1, std::memory_order_release);
+}
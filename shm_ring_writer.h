@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "output_buffer.h"
+#include "shm_ring.h"
+
+// Publishes output into a POSIX shared-memory broadcast ring. Flushed data
+// is split into slot-sized messages at line boundaries, so readers always
+// see whole greetings.
+//
+// The segment is not unlinked when the writer goes away: readers that
+// attach after the run can still read the last slot_count messages and
+// see the ring closed. The next writer with the same name replaces it.
+// Remove it with shm_unlink(), or rm /dev/shm/NAME on Linux, once no
+// reader needs it.
+class ShmRingWriter : public Sink {
+public:
+    // Throws std::runtime_error unless shm_ring::valid_geometry() holds.
+    ShmRingWriter(const std::string& name, std::size_t slot_count, std::size_t slot_size);
+    ~ShmRingWriter() override;
+
+    ShmRingWriter(const ShmRingWriter&) = delete;
+    ShmRingWriter& operator=(const ShmRingWriter&) = delete;
+
+    // Publishes data as messages of at most slot_size bytes. A message
+    // ends right after a '\n', unless a single line is longer than a slot
+    // and has to be cut. The ring is line-oriented: any '\n' byte can end
+    // a message, so binary data would be split at arbitrary points.
+    void write(std::string_view data) override;
+    // Publishes message as is, in one slot.
+    void publish(std::string_view message);
+
+    // Tells readers that no more messages will follow.
+    void close();
+
+private:
+    shm_ring::Header* header_ = nullptr;
+    std::size_t size_ = 0;
+    std::uint64_t next_ = 0;
+};
@@ -0,0 +1,156 @@
+// Checks that the greeting paths expected to be allocation-free stay so
+// once warmed up. Each path runs twice, with a short and a long name list,
+// and the difference in allocations is divided by the extra names, so
+// buffers set up once per run cancel out. A path fails when it allocates
+// more than once per thousand greetings, which still leaves room for the
+// occasional amortized buffer growth. bench_allocations reports the same
+// figures with timings.
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "counting_new.h"
+#include "greeting.h"
+#include "greeting_jobs.h"
+#include "names_mode.h"
+#include "output_buffer.h"
+
+namespace {
+
+class NullSink : public Sink {
+public:
+    void write(std::string_view) override {}
+};
+
+// Mostly plain names, with some that need JSON escaping and some non-ASCII
+// ones; every fifth JSON Lines record has a locale.
+std::string name_at(std::size_t i) {
+    static const char* stems[] = {"recipient", "Zo\xc3\xab", "O'Brien", "\xe7\x8e\x8b\xe5\xb0\x8f\xe6\x98\x8e"};
+    return stems[i % 4] + std::string("-") + std::to_string(i);
+}
+
+std::filesystem::path write_names(std::size_t count, InputFormat format) {
+    static const char* locales[] = {"de", "fr", "es", "xx", "pt-BR"};
+    std::filesystem::path path = std::filesystem::temp_directory_path() /
+                                 ("test_allocations_" + std::to_string(count) +
+                                  (format == InputFormat::jsonl ? ".jsonl" : ".txt"));
+    std::ofstream out(path, std::ios::binary);
+    for (std::size_t i = 0; i < count; ++i) {
+        if (format == InputFormat::text) {
+            out << name_at(i) << '\n';
+        } else if (i % 5 == 0) {
+            out << "{\"name\":\"" << name_at(i) << "\",\"locale\":\"" << locales[i / 5 % 5] << "\"}\n";
+        } else {
+            out << "{\"name\":\"" << name_at(i) << (i % 7 == 0 ? "\\t" : "") << "\"}\n";
+        }
+    }
+    return path;
+}
+
+std::uint64_t allocations_during(const std::function<void()>& run) {
+    std::uint64_t before = counting_new::allocations();
+    run();
+    return counting_new::allocations() - before;
+}
+
+struct Path {
+    const char* name;
+    std::function<void(std::size_t)> run; // greets the given number of names
+};
+
+} // namespace
+
+int main() {
+    constexpr std::size_t small = 2000;
+    constexpr std::size_t large = 20000;
+    constexpr double budget = 0.001;
+
+    std::vector<std::filesystem::path> files = {write_names(small, InputFormat::text),
+                                                write_names(large, InputFormat::text),
+                                                write_names(small, InputFormat::jsonl),
+                                                write_names(large, InputFormat::jsonl)};
+    auto names_mode = [&files](std::function<void(NamesOptions&)> set) {
+        NamesOptions options;
+        set(options);
+        return [options, &files](std::size_t count) mutable {
+            options.path = files[(options.input_format == InputFormat::jsonl ? 2 : 0) + (count == large ? 1 : 0)]
+                               .string();
+            NullSink sink;
+            OutputBuffer out(sink);
+            emit_names(options, out);
+            out.flush();
+        };
+    };
+
+    std::vector<std::string> names;
+    for (std::size_t i = 0; i < large; ++i) {
+        names.push_back(name_at(i));
+    }
+    std::vector<std::string_view> views(names.begin(), names.end());
+    GreetingCatalog catalog;
+
+    std::vector<Path> paths = {
+        {"write_greeting",
+         [&](std::size_t count) {
+             NullSink sink;
+             OutputBuffer out(sink);
+             for (std::size_t i = 0; i < count; ++i) {
+                 char* p = out.reserve(greeting_size(views[i]) + 1);
+                 *write_greeting(p, views[i]) = '\n';
+                 out.commit(greeting_size(views[i]) + 1);
+             }
+             out.flush();
+         }},
+        {"greet_many",
+         [&](std::size_t count) {
+             GreetingBatch batch;
+             for (std::size_t i = 0; i < count; i += 4096) {
+                 greet_many(views.data() + i, std::min<std::size_t>(4096, count - i), batch);
+             }
+         }},
+        {"greet_jobs",
+         [&](std::size_t count) {
+             static const char* locales[] = {"", "de", "fr", "pt-BR"};
+             GreetingJobs jobs;
+             GreetingBatch batch;
+             for (std::size_t i = 0; i < count; ++i) {
+                 jobs.add(views[i], locales[i % 4], catalog);
+                 if (jobs.size() == 4096 || i + 1 == count) {
+                     greet_jobs(jobs, catalog, batch);
+                     jobs.clear();
+                 }
+             }
+         }},
+        {"--names", names_mode([](NamesOptions&) {})},
+        {"--names --format jsonl", names_mode([](NamesOptions& o) { o.format = OutputFormat::jsonl; })},
+        {"--names --format binary", names_mode([](NamesOptions& o) { o.format = OutputFormat::binary; })},
+        {"--names --input-format jsonl", names_mode([](NamesOptions& o) { o.input_format = InputFormat::jsonl; })},
+        {"--names --dedup", names_mode([](NamesOptions& o) { o.dedup = true; })},
+    };
+
+    bool failed = false;
+    for (const Path& path : paths) {
+        std::uint64_t first = allocations_during([&] { path.run(small); });
+        std::uint64_t second = allocations_during([&] { path.run(large); });
+        double per_name =
+            (static_cast<double>(second) - static_cast<double>(first)) / static_cast<double>(large - small);
+        if (per_name > budget) {
+            std::printf("%s allocates %.4f times per name, more than %g\n", path.name, per_name, budget);
+            failed = true;
+        }
+    }
+    for (const auto& file : files) {
+        std::filesystem::remove(file);
+    }
+    if (failed) {
+        return 1;
+    }
+    std::printf("%zu paths allocate at most %g times per name\n", paths.size(), budget);
+    return 0;
+}
@@ -0,0 +1,167 @@
+// Checks CounterStore lookups against a plain map while counts move from
+// the memtable into segments: one batch large enough to freeze a table
+// mid-run, then several sessions whose close() each flush a segment, which
+// piles up enough segments to be compacted. Every session reopens the
+// store from its manifest. On POSIX a second process opening the store
+// must wait for the lock until the first one closes it.
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "counter_store.h"
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using Totals = std::map<std::string, std::uint64_t>;
+
+// Every lookup opens the segments, so of the names counted once only a
+// sample is looked up.
+bool check(const CounterStore& store, const Totals& expected, const char* when) {
+    std::size_t seen = 0;
+    for (const auto& entry : expected) {
+        if (entry.second == 1 && ++seen % 101 != 0) {
+            continue;
+        }
+        std::uint64_t count = store.lookup(entry.first);
+        if (count != entry.second) {
+            std::printf("%s: %s has %llu, expected %llu\n", when, entry.first.c_str(),
+                        static_cast<unsigned long long>(count), static_cast<unsigned long long>(entry.second));
+            return false;
+        }
+    }
+    if (store.lookup("never greeted") != 0) {
+        std::printf("%s: a name never added has a count\n", when);
+        return false;
+    }
+    return true;
+}
+
+std::size_t manifest_segments(const fs::path& dir) {
+    std::ifstream manifest(dir / "MANIFEST");
+    std::size_t count = 0;
+    std::string line;
+    while (std::getline(manifest, line)) {
+        count += !line.empty();
+    }
+    return count;
+}
+
+#ifndef _WIN32
+// Opens the store in another process while this one holds it. The child
+// has to wait until the store is closed, and its count must then be there.
+bool second_process_waits(const char* self, const fs::path& dir, Totals& expected) {
+    auto store = std::make_unique<CounterStore>(dir.string());
+    pid_t child = fork();
+    if (child < 0) {
+        std::printf("fork failed\n");
+        return false;
+    }
+    if (child == 0) {
+        execl(self, self, "--add-child", dir.string().c_str(), static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    usleep(300 * 1000);
+    int status = 0;
+    bool waited = waitpid(child, &status, WNOHANG) == 0;
+    // The lock is held until the store is destroyed.
+    store->close();
+    store.reset();
+    if (!waited) {
+        std::printf("a second process opened the store while it was held\n");
+        return false;
+    }
+    if (waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::printf("the second process failed once the store was closed\n");
+        return false;
+    }
+    ++expected["child"];
+    return true;
+}
+#endif
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc == 3 && std::string_view(argv[1]) == "--add-child") {
+        CounterStore store(argv[2]);
+        store.add_batch({"child"});
+        store.close();
+        return 0;
+    }
+
+    fs::path dir = fs::temp_directory_path() / ("test_counter_store_" + std::to_string(std::random_device{}()));
+    fs::remove_all(dir);
+    Totals expected;
+    bool ok = true;
+    {
+        // More distinct names than one memtable holds, so a table is frozen
+        // and flushed while the store is open.
+        CounterStore store(dir.string());
+        std::vector<std::string> batch;
+        for (std::size_t i = 0; i < 300000; ++i) {
+            batch.push_back("name-" + std::to_string(i));
+            ++expected[batch.back()];
+        }
+        store.add_batch(batch);
+        // Left in the new memtable, for close() to flush.
+        store.add_batch({"late"});
+        ++expected["late"];
+        ok = ok && check(store, expected, "first session");
+        store.close();
+        ok = ok && check(store, expected, "first session, closed");
+    }
+    std::size_t after_first = manifest_segments(dir);
+    if (after_first < 2) {
+        std::printf("first session left %zu segments, expected at least 2\n", after_first);
+        ok = false;
+    }
+    // Each session closes with a flush; four segments are merged into one.
+    for (int session = 0; ok && session < 5; ++session) {
+        CounterStore store(dir.string());
+        ok = check(store, expected, "reopened");
+        std::vector<std::string> batch;
+        for (std::size_t i = 0; i < 1000; ++i) {
+            batch.push_back("name-" + std::to_string(i * 7 % 2000));
+            batch.push_back("session-" + std::to_string(session));
+        }
+        store.add_batch(batch);
+        store.add_batch(batch);
+        for (int k = 0; k < 2; ++k) {
+            for (const std::string& name : batch) {
+                ++expected[name];
+            }
+        }
+        ok = ok && check(store, expected, "after adding");
+        store.close();
+    }
+    if (ok && manifest_segments(dir) >= 4) {
+        std::printf("segments were never compacted: %zu in the manifest\n", manifest_segments(dir));
+        ok = false;
+    }
+#ifndef _WIN32
+    ok = ok && second_process_waits(argv[0], dir, expected);
+#endif
+    if (ok) {
+        CounterStore store(dir.string());
+        ok = check(store, expected, "final reopen");
+    }
+    fs::remove_all(dir);
+    if (!ok) {
+        return 1;
+    }
+    std::printf("%zu names counted across sessions\n", expected.size());
+    return 0;
+}
@@ -0,0 +1,131 @@
+// Checks JsonlNameParser against records with known names and locales,
+// and checks that malformed records throw. Each block is parsed again with
+// padding in front, so records fall on every offset of the 64-byte stage 1
+// chunks. Run once per CPU level through HELLO_CPU, since the classifier is
+// picked once per process.
+
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "jsonl_parser.h"
+
+namespace {
+
+using Records = std::vector<std::pair<std::string, std::string>>;
+
+Records parse(const std::string& block) {
+    Records records;
+    JsonlNameParser parser;
+    parser.parse(block, [&](std::string_view name, std::string_view locale) {
+        records.emplace_back(std::string(name), std::string(locale));
+    });
+    return records;
+}
+
+struct Case {
+    const char* input;
+    Records expected;
+};
+
+bool check(const Case& c) {
+    for (std::size_t pad = 0; pad < 70; ++pad) {
+        std::string block = std::string(pad, ' ') + "\n" + c.input;
+        Records records;
+        try {
+            records = parse(block);
+        } catch (const std::exception& e) {
+            std::printf("unexpected error \"%s\" at offset %zu for: %s", e.what(), pad, c.input);
+            return false;
+        }
+        if (records != c.expected) {
+            std::printf("wrong records at offset %zu for: %s", pad, c.input);
+            for (const auto& record : records) {
+                std::printf("  got name \"%s\" locale \"%s\"\n", record.first.c_str(), record.second.c_str());
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+bool rejects(const char* input) {
+    for (std::size_t pad = 0; pad < 70; ++pad) {
+        std::string block = std::string(pad, ' ') + "\n" + input;
+        try {
+            parse(block);
+        } catch (const std::runtime_error&) {
+            continue;
+        }
+        std::printf("accepted at offset %zu: %s", pad, input);
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main() {
+    const Case cases[] = {
+        {"{\"name\":\"Ann\"}\n", {{"Ann", ""}}},
+        {"{\"name\":\"Ann\",\"locale\":\"de\"}\n{\"locale\":\"fr\",\"name\":\"Bo\"}\n", {{"Ann", "de"}, {"Bo", "fr"}}},
+        {"  { \"name\" : \"Cy\" , \"locale\" : \"pt-BR\" }  \r\n", {{"Cy", "pt-BR"}}},
+        {"{\"name\":\"Ann\"}", {{"Ann", ""}}},
+        {"\n\n{\"name\":\"Ann\"}\n\n", {{"Ann", ""}}},
+        // Escapes, and structural characters inside strings.
+        {"{\"name\":\"a\\\"b\\\\c\\/d\\n\\t\"}\n", {{"a\"b\\c/d\n\t", ""}}},
+        {"{\"name\":\"{[:,]}\"}\n", {{"{[:,]}", ""}}},
+        {"{\"name\":\"Zo\\u00eb \\ud83d\\ude00\"}\n", {{"Zo\xc3\xab \xf0\x9f\x98\x80", ""}}},
+        {"{\"name\":\"\\\\\"}\n", {{"\\", ""}}},
+        {"{\"name\":\"\"}\n", {{"", ""}}},
+        // Other members, of every kind, are skipped.
+        {"{\"id\":17,\"ok\":true,\"x\":null,\"f\":-1.5e3,\"name\":\"Di\"}\n", {{"Di", ""}}},
+        {"{\"tags\":[\"a\",{\"name\":\"inner\"}],\"name\":\"Ed\",\"meta\":{\"locale\":\"xx\"}}\n", {{"Ed", ""}}},
+        {"{\"name\":\"Fay\",\"name\":\"Gus\"}\n", {{"Gus", ""}}},
+        // Records without a string name.
+        {"{}\n{\"locale\":\"de\"}\n{\"name\":42}\n{\"name\":null}\n", {}},
+        {"{\"name\":[\"Hal\"]}\n{\"name\":\"Ivy\"}\n", {{"Ivy", ""}}},
+        // A long name that spans several stage 1 chunks.
+        {"{\"name\":\"0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef0123456789\"}\n",
+         {{"0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef0123456789", ""}}},
+    };
+    for (const Case& c : cases) {
+        if (!check(c)) {
+            return 1;
+        }
+    }
+
+    const char* malformed[] = {
+        "{\"name\" \"x\"}\n",
+        "{\"name\":\"x\",}\n",
+        "{\"name\":\"x\" \"y\"}\n",
+        "{\"name\":}\n",
+        "{\"a\":,\"name\":\"x\"}\n",
+        "{\"a\":1 2}\n",
+        "{name:\"x\"}\n",
+        "{\"name\"::\"x\"}\n",
+        "{,\"name\":\"x\"}\n",
+        "x{\"name\":\"x\"}\n",
+        "{\"name\":\"x\"}x\n",
+        "{\"name\":\"x\"}{\"name\":\"y\"}\n",
+        "{\"name\":\"x\"]\n",
+        "{\"name\":\"x\"\n",
+        "{\"name\":\"x\n",
+        "\"name\"\n",
+        "[\"x\"]\n",
+        "}\n",
+        "{\"name\":\"\\q\"}\n",
+        "{\"name\":\"\\u12\"}\n",
+        "{\"name\":\"\\ud800\"}\n",
+    };
+    for (const char* input : malformed) {
+        if (!rejects(input)) {
+            return 1;
+        }
+    }
+    std::printf("%zu records and %zu malformed inputs checked\n", sizeof(cases) / sizeof(cases[0]),
+                sizeof(malformed) / sizeof(malformed[0]));
+    return 0;
+}
@@ -0,0 +1,74 @@
+// Checks NameSet against std::unordered_set<std::string>: a table that
+// starts at its smallest size and grows many times, fed names that share
+// long prefixes, differ only in their last bytes, are empty or contain NUL
+// bytes, each inserted several times in random order. With this many names
+// the seven-bit tags collide often, so whole names are compared too.
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "name_arena.h"
+#include "name_set.h"
+
+namespace {
+
+std::vector<std::string> test_names() {
+    std::vector<std::string> names = {"", std::string(1, '\0'), std::string("a\0b", 3), std::string("a\0c", 3)};
+    const std::string prefix(200, 'p');
+    for (std::size_t i = 0; i < 20000; ++i) {
+        names.push_back("name-" + std::to_string(i));
+        // Equal in everything but the last bytes, so the hash sees the
+        // whole name.
+        names.push_back(prefix + std::to_string(i));
+        names.push_back(std::string(i % 300, 'x'));
+    }
+    return names;
+}
+
+} // namespace
+
+int main() {
+    std::vector<std::string> names = test_names();
+    std::vector<std::string> inserts;
+    for (int copy = 0; copy < 3; ++copy) {
+        inserts.insert(inserts.end(), names.begin(), names.end());
+    }
+    std::shuffle(inserts.begin(), inserts.end(), std::mt19937(7));
+
+    NameArena arena;
+    NameSet set(arena);
+    std::unordered_set<std::string> expected;
+    for (const std::string& name : inserts) {
+        auto result = set.insert(name);
+        bool inserted = expected.insert(name).second;
+        if (result.second != inserted || arena.view(result.first) != name) {
+            std::printf("insert of a %zu-byte name: inserted %d, expected %d\n", name.size(), result.second,
+                        inserted);
+            return 1;
+        }
+    }
+    if (set.size() != expected.size()) {
+        std::printf("size %zu, expected %zu\n", set.size(), expected.size());
+        return 1;
+    }
+    for (const std::string& name : names) {
+        if (!set.contains(name)) {
+            std::printf("a %zu-byte name went missing\n", name.size());
+            return 1;
+        }
+    }
+    for (std::size_t i = 0; i < 20000; ++i) {
+        std::string absent = "absent-" + std::to_string(i);
+        if (set.contains(absent) || set.contains(std::string(200, 'p') + "x" + std::to_string(i))) {
+            std::printf("contains a name never inserted\n");
+            return 1;
+        }
+    }
+    std::printf("%zu distinct of %zu names\n", set.size(), inserts.size());
+    return 0;
+}
@@ -0,0 +1,71 @@
+// Checks sort_names against std::sort on random names: empty names, bytes
+// above 0x7f that must order as unsigned, long shared prefixes that make
+// the radix sort recurse many levels, duplicates, and enough names for
+// buckets above the task cutoff, on one thread and on several.
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "name_arena.h"
+#include "name_sort.h"
+
+namespace {
+
+std::vector<std::string> random_names(std::size_t count, std::mt19937& random) {
+    const std::string prefixes[] = {"", "recipient-", std::string(100, 'p'), std::string(100, 'p') + "\xff"};
+    std::vector<std::string> names;
+    for (std::size_t i = 0; i < count; ++i) {
+        std::string name = prefixes[random() % 4];
+        // Short suffixes from a small alphabet repeat, so there are
+        // duplicates and names that are prefixes of others.
+        std::size_t length = random() % 8;
+        for (std::size_t j = 0; j < length; ++j) {
+            static const char bytes[] = {'\0', 'a', 'b', 'z', '\x7f', '\x80', '\xff'};
+            name += bytes[random() % sizeof(bytes)];
+        }
+        names.push_back(name);
+    }
+    return names;
+}
+
+bool check(const std::vector<std::string>& names, unsigned threads) {
+    NameArena arena;
+    std::vector<NameRef> refs;
+    for (const std::string& name : names) {
+        refs.push_back(arena.add(name));
+    }
+    sort_names(arena, refs, threads);
+    std::vector<std::string> expected = names;
+    std::sort(expected.begin(), expected.end());
+    if (refs.size() != expected.size()) {
+        std::printf("%zu names in, %zu out\n", expected.size(), refs.size());
+        return false;
+    }
+    for (std::size_t i = 0; i < refs.size(); ++i) {
+        if (arena.view(refs[i]) != expected[i]) {
+            std::printf("%u threads, %zu names: position %zu differs from std::sort\n", threads, names.size(), i);
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 random(59);
+    for (std::size_t count : {0, 1, 2, 63, 64, 65, 1000, 200000}) {
+        std::vector<std::string> names = random_names(count, random);
+        for (unsigned threads : {1u, 4u}) {
+            if (!check(names, threads)) {
+                return 1;
+            }
+        }
+    }
+    std::printf("sort_names agrees with std::sort\n");
+    return 0;
+}
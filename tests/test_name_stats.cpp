@@ -0,0 +1,100 @@
+// Checks the --stats sketches. The HyperLogLog estimate for N distinct
+// names, each added twice, must stay within four standard errors (4 x
+// 0.8 %) of N. Space-Saving, fed a shuffled stream where a few names
+// account for most greetings among many names seen once, must report the
+// heaviest names first, in order of their true counts, and every name it
+// guarantees to track. For every reported name the count must bound the
+// true count from above, and the count minus its error from below.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "hash.h"
+#include "name_stats.h"
+
+namespace {
+
+bool check_distinct() {
+    for (std::size_t n : {100, 10000, 100000, 1000000}) {
+        DistinctCounter counter;
+        for (int copy = 0; copy < 2; ++copy) {
+            for (std::size_t i = 0; i < n; ++i) {
+                counter.add(hash_bytes("name-" + std::to_string(i)));
+            }
+        }
+        double error = std::abs(counter.estimate() - static_cast<double>(n)) / static_cast<double>(n);
+        if (error > 4 * 0.008) {
+            std::printf("%zu distinct names estimated as %.0f\n", n, counter.estimate());
+            return false;
+        }
+    }
+    return true;
+}
+
+bool check_top() {
+    // 8 heavy hitters with counts from 20000 down to 6000, 100 names seen
+    // 600 times each, and 200000 names seen once. The 1024 names tracked
+    // for k = 128 guarantee every name seen more than n / 1024 times (about
+    // 300) is tracked, so all 108 frequent names must be reported.
+    constexpr std::size_t heavy = 8;
+    constexpr std::size_t k = 128;
+    std::vector<std::string> stream;
+    std::map<std::string, std::uint64_t> truth;
+    auto add = [&](const std::string& name, std::uint64_t count) {
+        stream.insert(stream.end(), count, name);
+        truth[name] = count;
+    };
+    for (std::size_t i = 0; i < heavy; ++i) {
+        add("heavy-" + std::to_string(i), 20000 - 2000 * i);
+    }
+    for (std::size_t i = 0; i < 100; ++i) {
+        add("frequent-" + std::to_string(i), 600);
+    }
+    for (std::size_t i = 0; i < 200000; ++i) {
+        add("once-" + std::to_string(i), 1);
+    }
+    std::shuffle(stream.begin(), stream.end(), std::mt19937(61));
+
+    TopNames top(k);
+    for (const std::string& name : stream) {
+        top.add(name, hash_bytes(name));
+    }
+    std::vector<TopNames::Entry> entries = top.top();
+    if (entries.size() != k) {
+        std::printf("%zu top names, expected %zu\n", entries.size(), k);
+        return false;
+    }
+    std::size_t frequent = 0;
+    for (std::size_t i = 0; i < k; ++i) {
+        const TopNames::Entry& entry = entries[i];
+        std::uint64_t actual = truth[entry.name];
+        bool expected_name = i >= heavy || entry.name == "heavy-" + std::to_string(i);
+        if (!expected_name || entry.count < actual || entry.count - entry.error > actual) {
+            std::printf("top %zu is %s with %llu (error %llu), true count %llu\n", i, entry.name.c_str(),
+                        static_cast<unsigned long long>(entry.count), static_cast<unsigned long long>(entry.error),
+                        static_cast<unsigned long long>(actual));
+            return false;
+        }
+        frequent += actual > stream.size() / 1024;
+    }
+    if (frequent != heavy + 100) {
+        std::printf("%zu of the %zu frequent names reported\n", frequent, heavy + 100);
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main() {
+    if (!check_distinct() || !check_top()) {
+        return 1;
+    }
+    std::printf("distinct estimates and top names within bounds\n");
+    return 0;
+}
@@ -0,0 +1,153 @@
+// Checks request/reply round trips through the shared-memory channel, with
+// ShmGreetingServer::run() on a thread of this process. Two clients greet
+// at once, each with enough requests of uneven sizes to wrap its rings
+// many times; every reply has to be the greeting for its own request, with
+// the locale's word. A catalog published while the server runs is used by
+// the requests that follow. Once the server is gone a waiting client gives
+// up instead of hanging.
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "greeting_jobs.h"
+#include "shm_channel.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+std::string expected_greeting(std::string_view word, std::string_view name) {
+    return name.empty() ? std::string(word) : std::string(word) + ", " + std::string(name);
+}
+
+struct Request {
+    std::string name;
+    std::string locale;
+    std::string word;
+};
+
+// Names from empty to a few kilobytes, some with NUL bytes, and locales
+// that are built in, added by the test's catalog, matched on a subtag, or
+// unknown and greeted with the default word.
+std::vector<Request> requests(unsigned client, std::size_t count) {
+    const Request locales[] = {{"", "", "Hello"},      {"", "fr", "Bonjour"}, {"", "xx", "Yo"},
+                               {"", "de-AT", "Hallo"}, {"", "zz", "Hello"},   {"", "EN", "Hello"}};
+    std::vector<Request> out;
+    for (std::size_t i = 0; i < count; ++i) {
+        Request request = locales[i % 6];
+        request.name = "client-" + std::to_string(client) + "-" + std::to_string(i);
+        if (i % 97 == 0) {
+            request.name.append(i % 4000, 'n');
+        } else if (i % 13 == 0) {
+            request.name.push_back('\0');
+        } else if (i % 31 == 0) {
+            request.name.clear();
+        }
+        out.push_back(std::move(request));
+    }
+    return out;
+}
+
+bool round_trips(const std::string& service, unsigned client, std::size_t count, std::size_t& bytes) {
+    ShmGreetingClient greeter(service);
+    for (const Request& request : requests(client, count)) {
+        std::string reply = greeter.greet(request.name, request.locale);
+        if (reply != expected_greeting(request.word, request.name)) {
+            std::printf("client %u: \"%s\" for a %zu-byte name in locale \"%s\"\n", client,
+                        reply.substr(0, 40).c_str(), request.name.size(), request.locale.c_str());
+            return false;
+        }
+        bytes += reply.size();
+    }
+    return true;
+}
+
+std::unique_ptr<GreetingCatalog> catalog_with(std::string_view word) {
+    auto catalog = std::make_unique<GreetingCatalog>();
+    catalog->add("xx", word);
+    return catalog;
+}
+
+} // namespace
+
+int main() {
+    const std::string service = "/hello_test_shm_channel_" + std::to_string(getpid());
+    const std::size_t count = 20000;
+    bool ok = true;
+    try {
+        std::size_t bytes = 0;
+        std::size_t greeted = 0;
+        std::size_t greeted_bytes = 0;
+        std::unique_ptr<ShmGreetingClient> late;
+        {
+            ShmGreetingServer server(service, catalog_with("Yo"));
+            server.on_greeted([&](std::string_view, std::size_t size) {
+                ++greeted;
+                greeted_bytes += size;
+            });
+            std::atomic<bool> stop{false};
+            std::thread serving([&] {
+                server.run(stop);
+            });
+
+            std::size_t other_bytes = 0;
+            bool other_ok = true;
+            std::thread other([&] {
+                other_ok = round_trips(service, 1, count, other_bytes);
+            });
+            ok = round_trips(service, 0, count, bytes);
+            other.join();
+            ok = ok && other_ok;
+            bytes += other_bytes;
+
+            ShmGreetingClient client(service);
+            try {
+                client.greet(std::string(shm_channel::max_message, 'n'));
+                std::printf("a name longer than a message was sent\n");
+                ok = false;
+            } catch (const std::length_error&) {
+            }
+            server.set_catalog(catalog_with("Salut"));
+            std::string reply = client.greet("Ada", "xx");
+            if (reply != "Salut, Ada") {
+                std::printf("after publishing a catalog: \"%s\"\n", reply.c_str());
+                ok = false;
+            }
+            bytes += reply.size();
+
+            stop = true;
+            serving.join();
+            ThreadCounters::Totals served = server.served();
+            if (served.greetings != 2 * count + 1 || served.bytes != bytes || greeted != served.greetings ||
+                greeted_bytes != bytes) {
+                std::printf("served %llu greetings of %llu bytes, %zu reported greeted, expected %zu of %zu\n",
+                            static_cast<unsigned long long>(served.greetings),
+                            static_cast<unsigned long long>(served.bytes), greeted, 2 * count + 1, bytes);
+                ok = false;
+            }
+            late = std::make_unique<ShmGreetingClient>(service);
+        }
+        try {
+            late->greet("Ada");
+            std::printf("a greeting came back after the server was destroyed\n");
+            ok = false;
+        } catch (const std::runtime_error&) {
+        }
+    } catch (const std::exception& e) {
+        std::printf("%s\n", e.what());
+        ok = false;
+    }
+    shm_unlink(service.c_str());
+    if (!ok) {
+        return 1;
+    }
+    std::printf("%zu requests answered over two channels\n", 2 * count + 1);
+    return 0;
+}
@@ -0,0 +1,152 @@
+// Checks the shared-memory broadcast ring in one process: ShmRingWriter
+// splits flushed output at line boundaries into slot-sized messages, and
+// ShmRingReader reads them back in order. A reader that falls more than
+// slot_count messages behind is lapped: it skips to the oldest message
+// still in the ring and counts the rest as lost. Readers see the ring
+// closed only once they have read everything.
+
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "shm_ring_reader.h"
+#include "shm_ring_writer.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr std::size_t slot_count = 8;
+constexpr std::size_t slot_size = 16;
+
+std::vector<std::string> drain(ShmRingReader& reader) {
+    std::vector<std::string> messages;
+    std::string message;
+    while (reader.read(message) == ShmRingReader::Status::message) {
+        messages.push_back(message);
+    }
+    return messages;
+}
+
+// Lines that fit are packed up to the last newline within a slot; a line
+// longer than a slot is cut at slot_size bytes.
+bool check_split(ShmRingWriter& writer, ShmRingReader& reader) {
+    const std::string data = "Hello, Ada!\nHi, Bo!\nHey, Cy!\n" + std::string(40, 'x') + "\nend\n";
+    writer.write(data);
+    std::vector<std::string> messages = drain(reader);
+    std::string joined;
+    for (const std::string& message : messages) {
+        bool whole = !message.empty() && message.back() == '\n';
+        if (message.size() > slot_size || (!whole && message.size() != slot_size)) {
+            std::printf("message \"%s\" is neither whole lines nor a full slot\n", message.c_str());
+            return false;
+        }
+        joined += message;
+    }
+    const std::vector<std::string> expected = {"Hello, Ada!\n", "Hi, Bo!\n", "Hey, Cy!\n", std::string(16, 'x'),
+                                               std::string(16, 'x'), std::string(8, 'x') + "\nend\n"};
+    if (joined != data || messages != expected) {
+        std::printf("output split into %zu messages, expected %zu\n", messages.size(), expected.size());
+        return false;
+    }
+    if (reader.lost() != 0) {
+        std::printf("a reader that kept up lost %llu messages\n", static_cast<unsigned long long>(reader.lost()));
+        return false;
+    }
+    return true;
+}
+
+// Publishes count numbered messages, more than the ring holds.
+void publish_numbered(ShmRingWriter& writer, int first, int count) {
+    for (int i = first; i < first + count; ++i) {
+        writer.publish(std::to_string(i));
+    }
+}
+
+bool check_lapped(const std::string& name, ShmRingWriter& writer, ShmRingReader& behind) {
+    publish_numbered(writer, 0, 20);
+    std::vector<std::string> messages = drain(behind);
+    if (messages.size() != slot_count || messages.front() != "12" || messages.back() != "19" ||
+        behind.lost() != 20 - slot_count) {
+        std::printf("lapped reader got %zu messages starting at %s, lost %llu\n", messages.size(),
+                    messages.empty() ? "none" : messages.front().c_str(),
+                    static_cast<unsigned long long>(behind.lost()));
+        return false;
+    }
+    // A reader attaching now starts with the next message, or with the
+    // oldest one still in the ring.
+    ShmRingReader next(name);
+    ShmRingReader oldest(name, true);
+    std::string message;
+    if (next.read(message) != ShmRingReader::Status::empty) {
+        std::printf("a new reader saw a message published before it attached\n");
+        return false;
+    }
+    messages = drain(oldest);
+    if (messages.size() != slot_count || messages.front() != "12" || oldest.lost() != 0) {
+        std::printf("reading from the oldest got %zu messages\n", messages.size());
+        return false;
+    }
+    publish_numbered(writer, 20, 1);
+    if (next.read(message) != ShmRingReader::Status::message || message != "20") {
+        std::printf("a new reader missed the next message\n");
+        return false;
+    }
+    return true;
+}
+
+bool check_closed(const std::string& name, ShmRingWriter& writer, ShmRingReader& reader) {
+    std::string message;
+    if (reader.read(message) != ShmRingReader::Status::empty) {
+        std::printf("read did not report an open, empty ring\n");
+        return false;
+    }
+    writer.publish("last");
+    writer.close();
+    if (reader.read(message) != ShmRingReader::Status::message || message != "last" ||
+        reader.read(message) != ShmRingReader::Status::closed) {
+        std::printf("the last message or the close went missing\n");
+        return false;
+    }
+    // The segment outlives the writer's close for readers attaching late.
+    ShmRingReader late(name, true);
+    if (late.read_wait(message) != ShmRingReader::Status::message || drain(late).size() != slot_count - 1 ||
+        late.read_wait(message) != ShmRingReader::Status::closed) {
+        std::printf("a late reader did not see the whole closed ring\n");
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main() {
+    const std::string name = "/hello_test_shm_ring_" + std::to_string(getpid());
+    bool ok = true;
+    try {
+        ShmRingWriter writer(name, slot_count, slot_size);
+        ShmRingReader reader(name);
+        ok = check_split(writer, reader);
+        ShmRingReader behind(name);
+        ok = ok && check_lapped(name, writer, behind);
+        drain(reader);
+        ok = ok && check_closed(name, writer, reader);
+    } catch (const std::exception& e) {
+        std::printf("%s\n", e.what());
+        ok = false;
+    }
+    shm_unlink(name.c_str());
+    try {
+        ShmRingReader missing(name);
+        std::printf("attached to a ring that does not exist\n");
+        ok = false;
+    } catch (const std::runtime_error&) {
+    }
+    if (!ok) {
+        return 1;
+    }
+    std::printf("ring messages read back in order\n");
+    return 0;
+}
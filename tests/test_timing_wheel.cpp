@@ -0,0 +1,164 @@
+// Checks TimingWheel against a sorted list of deadlines, driving it with a
+// manual clock instead of the scheduler's timerfd. Timers land on every
+// level, on and around the ticks where a level cascades into the one below,
+// and the wheel starts just before such a boundary. Stepping from one
+// next_expiry() to the next, every timer has to fire on exactly its
+// deadline tick; advancing in uneven jumps, timers have to come out in
+// deadline order. Cancelled timers never fire.
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "timing_wheel.h"
+
+namespace {
+
+using Expected = std::multimap<std::uint64_t, std::uint64_t>; // deadline -> payload
+
+// Deadlines relative to start on every level and around the cascade
+// boundaries of each, plus random ones; some are cancelled again.
+bool schedule(TimingWheel& wheel, Expected& expected, std::mt19937& random) {
+    std::uint64_t start = wheel.now();
+    std::vector<std::uint64_t> deadlines;
+    for (std::uint64_t boundary : {1ull << 8, 1ull << 16, 1ull << 24}) {
+        std::uint64_t aligned = (start / boundary + 1) * boundary;
+        for (std::uint64_t d : {aligned - 1, aligned, aligned + 1, aligned + boundary, aligned + 2 * boundary - 1}) {
+            deadlines.push_back(d);
+        }
+    }
+    for (int i = 0; i < 3000; ++i) {
+        std::uint64_t range = std::uint64_t(1) << (8 * (1 + random() % 3));
+        deadlines.push_back(start + 1 + random() % range);
+    }
+    deadlines.push_back(start + (1ull << 24) + 12345); // level 3
+    deadlines.push_back(start + 1);
+    deadlines.push_back(start + 1); // two on the same tick
+    std::vector<TimingWheel::TimerId> cancelled;
+    for (std::size_t i = 0; i < deadlines.size(); ++i) {
+        TimingWheel::TimerId id = wheel.insert(deadlines[i], i);
+        if (i % 7 == 3) {
+            cancelled.push_back(id);
+        } else {
+            expected.emplace(deadlines[i], i);
+        }
+    }
+    for (TimingWheel::TimerId id : cancelled) {
+        if (!wheel.cancel(id) || wheel.cancel(id)) {
+            std::printf("cancel did not take exactly once\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+bool step_by_next_expiry(std::uint64_t start) {
+    std::mt19937 random(55);
+    TimingWheel wheel(start);
+    Expected expected;
+    if (!schedule(wheel, expected, random)) {
+        return false;
+    }
+    if (wheel.size() != expected.size()) {
+        std::printf("%zu timers pending, expected %zu\n", wheel.size(), expected.size());
+        return false;
+    }
+    std::vector<std::uint64_t> expired;
+    while (wheel.size() != 0) {
+        std::uint64_t tick = wheel.next_expiry();
+        // Nothing may be skipped, and the wheel never names a past tick.
+        if (tick <= wheel.now() || expected.empty() || tick > expected.begin()->first) {
+            std::printf("next expiry %llu at tick %llu\n", static_cast<unsigned long long>(tick),
+                        static_cast<unsigned long long>(wheel.now()));
+            return false;
+        }
+        expired.clear();
+        wheel.advance(tick, expired);
+        std::vector<std::uint64_t> due;
+        for (auto it = expected.begin(); it != expected.end() && it->first == tick;) {
+            due.push_back(it->second);
+            it = expected.erase(it);
+        }
+        std::sort(expired.begin(), expired.end());
+        std::sort(due.begin(), due.end());
+        if (expired != due) {
+            std::printf("tick %llu: %zu timers fired, %zu due\n", static_cast<unsigned long long>(tick),
+                        expired.size(), due.size());
+            return false;
+        }
+    }
+    return expected.empty();
+}
+
+bool advance_in_jumps(std::uint64_t start) {
+    std::mt19937 random(56);
+    TimingWheel wheel(start);
+    Expected expected;
+    if (!schedule(wheel, expected, random)) {
+        return false;
+    }
+    std::vector<std::uint64_t> expired;
+    while (wheel.size() != 0) {
+        std::uint64_t now = wheel.now() + 1 + random() % 5000;
+        expired.clear();
+        wheel.advance(now, expired);
+        for (std::uint64_t payload : expired) {
+            auto it = expected.begin();
+            // Ties on a tick may come out in any order.
+            while (it != expected.end() && it->first == expected.begin()->first && it->second != payload) {
+                ++it;
+            }
+            if (it == expected.end() || it->first != expected.begin()->first || it->first > now) {
+                std::printf("timer %llu fired out of order at %llu\n", static_cast<unsigned long long>(payload),
+                            static_cast<unsigned long long>(now));
+                return false;
+            }
+            expected.erase(it);
+        }
+        if (!expected.empty() && expected.begin()->first <= now) {
+            std::printf("a timer due by %llu did not fire\n", static_cast<unsigned long long>(now));
+            return false;
+        }
+    }
+    return expected.empty();
+}
+
+// Deadlines not in the future fire on the next tick, and one far beyond
+// the range is still accepted.
+bool check_clamping() {
+    TimingWheel wheel(1000);
+    std::vector<std::uint64_t> expired;
+    wheel.insert(10, 1);
+    wheel.insert(1000, 2);
+    wheel.advance(1001, expired);
+    std::sort(expired.begin(), expired.end());
+    if (expired != std::vector<std::uint64_t>{1, 2}) {
+        std::printf("past deadlines did not fire on the next tick\n");
+        return false;
+    }
+    wheel.insert(~0ull, 3);
+    if (wheel.next_expiry() <= wheel.now()) {
+        std::printf("next expiry not in the future\n");
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main() {
+    // Zero, then just before a level 1 and a level 2 cascade.
+    for (std::uint64_t start : {0ull, (1ull << 16) - 3, 5 * (1ull << 24) - 2}) {
+        if (!step_by_next_expiry(start) || !advance_in_jumps(start)) {
+            std::printf("starting at tick %llu\n", static_cast<unsigned long long>(start));
+            return 1;
+        }
+    }
+    if (!check_clamping()) {
+        return 1;
+    }
+    std::printf("timers fired on their deadlines\n");
+    return 0;
+}
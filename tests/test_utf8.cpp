@@ -0,0 +1,150 @@
+// Checks every UTF-8 validator the host can run against the scalar
+// decoder: hand-picked valid and invalid sequences at every offset around
+// the 16-, 32- and 64-byte block edges, then random well-formed text with
+// random corruptions. Exits with status 1 on the first disagreement.
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "cpu_dispatch.h"
+#include "utf8.h"
+
+namespace {
+
+struct Validator {
+    const char* name;
+    bool (*validate)(const char*, std::size_t);
+};
+
+std::vector<Validator> validators() {
+    std::vector<Validator> list = {{"dispatched", validate_utf8}, {"ascii fast path", validate_utf8_ascii_fast_path}};
+#ifdef __SSSE3__
+    list.push_back({"ssse3", validate_utf8_ssse3});
+#endif
+#ifdef HELLO_X86_DISPATCH
+    if (cpu_level() >= CpuLevel::avx2) {
+        list.push_back({"avx2", validate_utf8_avx2});
+    }
+    if (cpu_level() >= CpuLevel::avx512) {
+        list.push_back({"avx512", validate_utf8_avx512});
+    }
+#endif
+    return list;
+}
+
+std::string hex(const std::string& s) {
+    std::string out;
+    char byte[4];
+    for (unsigned char c : s) {
+        std::snprintf(byte, sizeof(byte), "%02x ", c);
+        out += byte;
+    }
+    return out;
+}
+
+bool agree(const std::vector<Validator>& list, const std::string& input) {
+    bool expected = validate_utf8_scalar(input.data(), input.size());
+    for (const Validator& v : list) {
+        if (v.validate(input.data(), input.size()) != expected) {
+            std::printf("%s says %s, scalar says %s, for %zu bytes: %s\n", v.name,
+                        expected ? "invalid" : "valid", expected ? "valid" : "invalid", input.size(),
+                        hex(input).c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+void append_code_point(std::string& out, std::uint32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xc0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3f));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xe0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (cp & 0x3f));
+    } else {
+        out += static_cast<char>(0xf0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3f));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (cp & 0x3f));
+    }
+}
+
+} // namespace
+
+int main() {
+    const std::vector<Validator> list = validators();
+    const char* samples[] = {
+        "a", "\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80", "\xef\xbf\xbf", "\xf4\x8f\xbf\xbf",
+        "\xc0\xaf",         // overlong '/'
+        "\xc1\xbf",         // overlong
+        "\xe0\x80\xaf",     // overlong
+        "\xf0\x80\x80\xaf", // overlong
+        "\xed\xa0\x80",     // surrogate
+        "\xed\xbf\xbf",     // surrogate
+        "\xf4\x90\x80\x80", // above U+10FFFF
+        "\xf5\x80\x80\x80", "\xff", "\xfe", "\x80", "\xbf",
+        "\xc3",             // truncated
+        "\xe2\x82",         // truncated
+        "\xf0\x9f\x98",     // truncated
+        "\xc3\xa9\xa9",     // extra continuation
+        "\xe2\x28\xa1", "\xf0\x28\x8c\x28",
+    };
+    std::size_t checked = 0;
+    for (const char* sample : samples) {
+        for (std::size_t offset = 0; offset <= 130; ++offset) {
+            for (std::size_t trailing : {0, 1, 3, 64}) {
+                std::string input(offset, 'x');
+                input += sample;
+                input.append(trailing, 'y');
+                if (!agree(list, input)) {
+                    return 1;
+                }
+                ++checked;
+            }
+        }
+    }
+
+    std::mt19937 random(12345);
+    for (int round = 0; round < 20000; ++round) {
+        std::string input;
+        std::size_t length = random() % 300;
+        while (input.size() < length) {
+            switch (random() % 4) {
+            case 0:
+                append_code_point(input, random() % 0x80);
+                break;
+            case 1:
+                append_code_point(input, 0x80 + random() % (0x800 - 0x80));
+                break;
+            case 2: {
+                std::uint32_t cp = 0x800 + random() % (0x10000 - 0x800);
+                append_code_point(input, cp >= 0xd800 && cp < 0xe000 ? cp - 0x800 : cp);
+                break;
+            }
+            default:
+                append_code_point(input, 0x10000 + random() % (0x110000 - 0x10000));
+                break;
+            }
+        }
+        // Most inputs get a few bytes replaced or cut off.
+        for (unsigned k = random() % 4; k != 0 && !input.empty(); --k) {
+            if (random() % 3 == 0) {
+                input.resize(random() % input.size());
+            } else {
+                input[random() % input.size()] = static_cast<char>(random());
+            }
+        }
+        if (!agree(list, input)) {
+            return 1;
+        }
+        ++checked;
+    }
+    std::printf("%zu inputs, %zu validators agree with the scalar decoder\n", checked, list.size());
+    return 0;
+}
@@ -0,0 +1,24 @@
+#include "thread_counters.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+ThreadCounters::ThreadCounters(std::size_t max_threads) : slots_(new Slot[max_threads]), max_threads_(max_threads) {}
+
+std::size_t ThreadCounters::add_thread() {
+    std::size_t slot = threads_.fetch_add(1);
+    if (slot >= max_threads_) {
+        throw std::length_error("too many counting threads");
+    }
+    return slot;
+}
+
+ThreadCounters::Totals ThreadCounters::read() const {
+    Totals totals;
+    std::size_t threads = std::min(threads_.load(), max_threads_);
+    for (std::size_t i = 0; i < threads; ++i) {
+        totals.greetings += slots_[i].greetings.load(std::memory_order_relaxed);
+        totals.bytes += slots_[i].bytes.load(std::memory_order_relaxed);
+    }
+    return totals;
+}
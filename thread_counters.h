@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Greeting and byte counts for threads that greet concurrently. Each thread
+// counts into its own cache line, so counting never moves a line between
+// cores; read() sums the slots. Like Qsbr readers, a counting thread takes
+// a slot once with add_thread().
+class ThreadCounters {
+public:
+    struct Totals {
+        std::uint64_t greetings = 0;
+        std::uint64_t bytes = 0;
+    };
+
+    explicit ThreadCounters(std::size_t max_threads);
+
+    std::size_t add_thread();
+
+    // Only the thread that owns slot may add to it, so this is a plain
+    // load and store rather than a locked read-modify-write.
+    void add(std::size_t slot, std::uint64_t bytes) {
+        Slot& s = slots_[slot];
+        s.greetings.store(s.greetings.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        s.bytes.store(s.bytes.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+    }
+
+    // From any thread; concurrent adds may or may not be included.
+    Totals read() const;
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<std::uint64_t> greetings{0};
+        std::atomic<std::uint64_t> bytes{0};
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+    std::size_t max_threads_;
+    std::atomic<std::size_t> threads_{0};
+};
@@ -0,0 +1,119 @@
+#include "timing_wheel.h"
+
+#include <algorithm>
+
+TimingWheel::TimerId TimingWheel::insert(std::uint64_t deadline, std::uint64_t payload) {
+    std::uint32_t index;
+    if (free_ != nil) {
+        index = free_;
+        free_ = nodes_[index].next;
+    } else {
+        index = static_cast<std::uint32_t>(nodes_.size());
+        nodes_.push_back(Node{});
+    }
+    Node& node = nodes_[index];
+    constexpr std::uint64_t range = std::uint64_t(1) << (levels * slot_bits);
+    node.deadline = std::min(std::max(deadline, now_ + 1), now_ + range - 1);
+    node.payload = payload;
+    link(index);
+    ++size_;
+    return (std::uint64_t(node.generation) << 32) | index;
+}
+
+bool TimingWheel::cancel(TimerId id) {
+    std::uint32_t index = static_cast<std::uint32_t>(id);
+    if (index >= nodes_.size() || nodes_[index].generation != static_cast<std::uint32_t>(id >> 32) ||
+        nodes_[index].level == levels) {
+        return false;
+    }
+    unlink(index);
+    release(index);
+    return true;
+}
+
+void TimingWheel::advance(std::uint64_t now, std::vector<std::uint64_t>& expired) {
+    while (now_ < now) {
+        if (size_ == 0) {
+            now_ = now;
+            return;
+        }
+        ++now_;
+        // When a level's lower bits wrap to zero, its current slot is due
+        // to be spread over the levels below. Higher levels go first, since
+        // their timers may land in a lower slot that is cascaded next.
+        for (unsigned level = levels - 1; level > 0; --level) {
+            if ((now_ & ((std::uint64_t(1) << (level * slot_bits)) - 1)) == 0) {
+                cascade(level);
+            }
+        }
+        std::uint32_t& head = slots_[0][now_ & (slot_count - 1)];
+        while (head != nil) {
+            std::uint32_t index = head;
+            expired.push_back(nodes_[index].payload);
+            unlink(index);
+            release(index);
+        }
+    }
+}
+
+std::uint64_t TimingWheel::next_expiry() const {
+    // Higher levels only cascade when the lowest level wraps, at multiples
+    // of slot_count.
+    std::uint64_t boundary = (now_ | (slot_count - 1)) + 1;
+    for (std::uint64_t tick = now_ + 1; tick < boundary; ++tick) {
+        if (slots_[0][tick & (slot_count - 1)] != nil) {
+            return tick;
+        }
+    }
+    return boundary;
+}
+
+void TimingWheel::link(std::uint32_t index) {
+    Node& node = nodes_[index];
+    std::uint64_t delta = node.deadline - now_;
+    unsigned level = 0;
+    while (level + 1 < levels && delta >= (std::uint64_t(1) << ((level + 1) * slot_bits))) {
+        ++level;
+    }
+    node.level = static_cast<std::uint16_t>(level);
+    node.slot = static_cast<std::uint16_t>((node.deadline >> (level * slot_bits)) & (slot_count - 1));
+    std::uint32_t& head = slots_[level][node.slot];
+    node.prev = nil;
+    node.next = head;
+    if (head != nil) {
+        nodes_[head].prev = index;
+    }
+    head = index;
+}
+
+void TimingWheel::unlink(std::uint32_t index) {
+    Node& node = nodes_[index];
+    if (node.prev != nil) {
+        nodes_[node.prev].next = node.next;
+    } else {
+        slots_[node.level][node.slot] = node.next;
+    }
+    if (node.next != nil) {
+        nodes_[node.next].prev = node.prev;
+    }
+    node.level = levels;
+}
+
+void TimingWheel::release(std::uint32_t index) {
+    Node& node = nodes_[index];
+    ++node.generation;
+    node.next = free_;
+    free_ = index;
+    --size_;
+}
+
+void TimingWheel::cascade(unsigned level) {
+    std::uint32_t& head = slots_[level][(now_ >> (level * slot_bits)) & (slot_count - 1)];
+    std::uint32_t index = head;
+    head = nil;
+    while (index != nil) {
+        std::uint32_t next = nodes_[index].next;
+        link(index);
+        index = next;
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Hierarchical timing wheel: four levels of 256 slots, each level covering
+// 256 times the range of the one below. Insert and cancel are O(1); timers
+// move down one level at a time as their deadline approaches and expire in
+// whole-slot batches. Deadlines are in ticks; anything more than 2^32 ticks
+// ahead is clamped to the end of the range.
+class TimingWheel {
+public:
+    using TimerId = std::uint64_t;
+
+    explicit TimingWheel(std::uint64_t now = 0) : now_(now) {
+        for (auto& level : slots_) {
+            for (auto& head : level) {
+                head = nil;
+            }
+        }
+    }
+
+    std::uint64_t now() const {
+        return now_;
+    }
+
+    std::size_t size() const {
+        return size_;
+    }
+
+    TimerId insert(std::uint64_t deadline, std::uint64_t payload);
+
+    // Returns false if the timer already expired or was cancelled.
+    bool cancel(TimerId id);
+
+    // Moves time forward to now, appending the payloads of expired timers.
+    void advance(std::uint64_t now, std::vector<std::uint64_t>& expired);
+
+    // The first tick at which advance() can expire a timer: the deadline of
+    // the earliest timer in the lowest level, or the next tick that cascades
+    // a higher level, whichever comes first. Nothing expires before it.
+    std::uint64_t next_expiry() const;
+
+private:
+    static constexpr unsigned levels = 4;
+    static constexpr unsigned slot_bits = 8;
+    static constexpr unsigned slot_count = 1 << slot_bits;
+    static constexpr std::uint32_t nil = 0xffffffff;
+
+    struct Node {
+        std::uint64_t deadline;
+        std::uint64_t payload;
+        std::uint32_t prev;
+        std::uint32_t next;
+        std::uint32_t generation;
+        std::uint16_t level; // levels when not linked into a slot
+        std::uint16_t slot;
+    };
+
+    void link(std::uint32_t index);
+    void unlink(std::uint32_t index);
+    void release(std::uint32_t index);
+    void cascade(unsigned level);
+
+    std::vector<Node> nodes_;
+    std::uint32_t free_ = nil;
+    std::uint32_t slots_[levels][slot_count];
+    std::uint64_t now_;
+    std::size_t size_ = 0;
+};
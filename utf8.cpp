@@ -0,0 +1,365 @@
+#include "utf8.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HELLO_UTF8_SSE2
+#endif
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+#ifdef HELLO_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Validates the code point starting at data[i] and returns the index after
+// it, or 0 if it is malformed. data[i] must not be ASCII.
+std::size_t decode(const unsigned char* data, std::size_t size, std::size_t i) {
+    unsigned char c = data[i];
+    std::size_t length;
+    unsigned char low = 0x80;
+    unsigned char high = 0xbf;
+    if (c < 0xc2) {
+        return 0;
+    } else if (c < 0xe0) {
+        length = 2;
+    } else if (c < 0xf0) {
+        length = 3;
+        low = c == 0xe0 ? 0xa0 : 0x80;  // overlong
+        high = c == 0xed ? 0x9f : 0xbf; // surrogates
+    } else if (c < 0xf5) {
+        length = 4;
+        low = c == 0xf0 ? 0x90 : 0x80;  // overlong
+        high = c == 0xf4 ? 0x8f : 0xbf; // above U+10FFFF
+    } else {
+        return 0;
+    }
+    if (size - i < length || data[i + 1] < low || data[i + 1] > high) {
+        return 0;
+    }
+    for (std::size_t k = 2; k < length; ++k) {
+        if ((data[i + k] & 0xc0) != 0x80) {
+            return 0;
+        }
+    }
+    return i + length;
+}
+
+bool is_ascii_block(const unsigned char* p) {
+#ifdef HELLO_UTF8_SSE2
+    return _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) == 0;
+#else
+    std::uint64_t a;
+    std::uint64_t b;
+    std::memcpy(&a, p, 8);
+    std::memcpy(&b, p + 8, 8);
+    return ((a | b) & 0x8080808080808080ull) == 0;
+#endif
+}
+
+} // namespace
+
+bool validate_utf8_scalar(const char* data, std::size_t size) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < size;) {
+        if (bytes[i] < 0x80) {
+            ++i;
+        } else if ((i = decode(bytes, size, i)) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool validate_utf8_ascii_fast_path(const char* data, std::size_t size) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    std::size_t i = 0;
+    while (i < size) {
+        if (size - i >= 16 && is_ascii_block(bytes + i)) {
+            i += 16;
+            continue;
+        }
+        // Decode past the block that was not all ASCII, then go back to
+        // skipping.
+        std::size_t end = i + 16 < size ? i + 16 : size;
+        while (i < end) {
+            if (bytes[i] < 0x80) {
+                ++i;
+            } else if ((i = decode(bytes, size, i)) == 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+#if defined(__SSSE3__) || defined(HELLO_X86_DISPATCH)
+namespace {
+
+// Error classes of the lookup algorithm: each table maps a nibble to the
+// errors it could be part of; an error exists where all three agree.
+constexpr std::uint8_t too_short = 1 << 0;
+constexpr std::uint8_t too_long = 1 << 1;
+constexpr std::uint8_t overlong_3 = 1 << 2;
+constexpr std::uint8_t too_large = 1 << 3;
+constexpr std::uint8_t surrogate = 1 << 4;
+constexpr std::uint8_t overlong_2 = 1 << 5;
+constexpr std::uint8_t too_large_1000 = 1 << 6;
+constexpr std::uint8_t overlong_4 = 1 << 6;
+constexpr std::uint8_t two_conts = 1 << 7;
+constexpr std::uint8_t carry = too_short | too_long | two_conts;
+
+alignas(16) constexpr std::uint8_t byte_1_high[16] = {
+    too_long, too_long, too_long, too_long, too_long, too_long, too_long, too_long,
+    two_conts, two_conts, two_conts, two_conts, too_short | overlong_2, too_short,
+    too_short | overlong_3 | surrogate, too_short | too_large | too_large_1000 | overlong_4};
+alignas(16) constexpr std::uint8_t byte_1_low[16] = {
+    carry | overlong_3 | overlong_2 | overlong_4, carry | overlong_2, carry, carry, carry | too_large,
+    carry | too_large | too_large_1000, carry | too_large | too_large_1000, carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000, carry | too_large | too_large_1000, carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000, carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000 | surrogate, carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000};
+alignas(16) constexpr std::uint8_t byte_2_high[16] = {
+    too_short, too_short, too_short, too_short, too_short, too_short, too_short, too_short,
+    too_long | overlong_2 | two_conts | overlong_3 | too_large_1000 | overlong_4,
+    too_long | overlong_2 | two_conts | overlong_3 | too_large,
+    too_long | overlong_2 | two_conts | surrogate | too_large,
+    too_long | overlong_2 | two_conts | surrogate | too_large, too_short, too_short, too_short, too_short};
+// Bytes above these start a sequence that needs more bytes than remain in
+// the block at its last three positions. The last 16, 32 or 64 bytes are
+// used for the block size.
+alignas(64) constexpr std::uint8_t incomplete_max[64] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xf0 - 1, 0xe0 - 1, 0xc0 - 1};
+
+} // namespace
+#endif
+
+#ifdef __SSSE3__
+namespace {
+
+__m128i load_table(const std::uint8_t* table) {
+    return _mm_load_si128(reinterpret_cast<const __m128i*>(table));
+}
+
+__m128i high_nibbles(__m128i v) {
+    return _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0f));
+}
+
+__m128i check_block(__m128i input, __m128i previous) {
+    __m128i prev1 = _mm_alignr_epi8(input, previous, 15);
+    __m128i special = _mm_and_si128(
+        _mm_and_si128(_mm_shuffle_epi8(load_table(byte_1_high), high_nibbles(prev1)),
+                      _mm_shuffle_epi8(load_table(byte_1_low), _mm_and_si128(prev1, _mm_set1_epi8(0x0f)))),
+        _mm_shuffle_epi8(load_table(byte_2_high), high_nibbles(input)));
+
+    // Third and fourth bytes of a sequence must be continuations; those are
+    // the only places two_conts is expected.
+    __m128i prev2 = _mm_alignr_epi8(input, previous, 14);
+    __m128i prev3 = _mm_alignr_epi8(input, previous, 13);
+    __m128i third = _mm_subs_epu8(prev2, _mm_set1_epi8(static_cast<char>(0xe0 - 0x80)));
+    __m128i fourth = _mm_subs_epu8(prev3, _mm_set1_epi8(static_cast<char>(0xf0 - 0x80)));
+    __m128i must_be_2_3_continuation =
+        _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8(static_cast<char>(0x80)));
+    return _mm_xor_si128(must_be_2_3_continuation, special);
+}
+
+// Non-zero if the block ends in the middle of a multi-byte sequence.
+__m128i incomplete(__m128i input) {
+    return _mm_subs_epu8(input, load_table(incomplete_max + 48));
+}
+
+} // namespace
+
+bool validate_utf8_ssse3(const char* data, std::size_t size) {
+    __m128i error = _mm_setzero_si128();
+    __m128i previous = _mm_setzero_si128();
+    __m128i previous_incomplete = _mm_setzero_si128();
+    std::size_t i = 0;
+    auto step = [&](__m128i input) {
+        if (_mm_movemask_epi8(input) == 0) {
+            error = _mm_or_si128(error, previous_incomplete);
+        } else {
+            error = _mm_or_si128(error, check_block(input, previous));
+            previous_incomplete = incomplete(input);
+        }
+        previous = input;
+    };
+    for (; i + 16 <= size; i += 16) {
+        step(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)));
+    }
+    if (i < size) {
+        char tail[16] = {};
+        std::memcpy(tail, data + i, size - i);
+        step(_mm_loadu_si128(reinterpret_cast<const __m128i*>(tail)));
+    }
+    error = _mm_or_si128(error, previous_incomplete);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xffff;
+}
+#endif
+
+#ifdef HELLO_X86_DISPATCH
+// The same algorithm on 32 and 64 bytes. The byte shuffles and alignr work
+// within 16-byte lanes, so the previous input is first shifted by a whole
+// lane across the vector.
+namespace {
+
+HELLO_TARGET("avx2") __m256i load_table_256(const std::uint8_t* table) {
+    return _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(table)));
+}
+
+HELLO_TARGET("avx2") __m256i high_nibbles_256(__m256i v) {
+    return _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0f));
+}
+
+HELLO_TARGET("avx2") __m256i check_block_256(__m256i input, __m256i previous) {
+    __m256i lanes = _mm256_permute2x128_si256(previous, input, 0x21);
+    __m256i prev1 = _mm256_alignr_epi8(input, lanes, 15);
+    __m256i special = _mm256_and_si256(
+        _mm256_and_si256(
+            _mm256_shuffle_epi8(load_table_256(byte_1_high), high_nibbles_256(prev1)),
+            _mm256_shuffle_epi8(load_table_256(byte_1_low), _mm256_and_si256(prev1, _mm256_set1_epi8(0x0f)))),
+        _mm256_shuffle_epi8(load_table_256(byte_2_high), high_nibbles_256(input)));
+    __m256i prev2 = _mm256_alignr_epi8(input, lanes, 14);
+    __m256i prev3 = _mm256_alignr_epi8(input, lanes, 13);
+    __m256i third = _mm256_subs_epu8(prev2, _mm256_set1_epi8(static_cast<char>(0xe0 - 0x80)));
+    __m256i fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8(static_cast<char>(0xf0 - 0x80)));
+    __m256i must_be_2_3_continuation =
+        _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8(static_cast<char>(0x80)));
+    return _mm256_xor_si256(must_be_2_3_continuation, special);
+}
+
+// A 16-byte table repeated in all four lanes, loaded with one aligned
+// 64-byte load instead of a broadcast.
+struct LaneTable {
+    alignas(64) std::uint8_t bytes[64];
+};
+
+constexpr LaneTable replicate(const std::uint8_t (&table)[16]) {
+    LaneTable replicated{};
+    for (std::size_t i = 0; i < 64; ++i) {
+        replicated.bytes[i] = table[i % 16];
+    }
+    return replicated;
+}
+
+constexpr LaneTable byte_1_high_512 = replicate(byte_1_high);
+constexpr LaneTable byte_1_low_512 = replicate(byte_1_low);
+constexpr LaneTable byte_2_high_512 = replicate(byte_2_high);
+
+// The lookup tables, loaded once per call.
+struct Tables512 {
+    __m512i byte_1_high;
+    __m512i byte_1_low;
+    __m512i byte_2_high;
+};
+
+HELLO_TARGET("avx512f,avx512bw") __m512i high_nibbles_512(__m512i v) {
+    return _mm512_and_si512(_mm512_srli_epi16(v, 4), _mm512_set1_epi8(0x0f));
+}
+
+HELLO_TARGET("avx512f,avx512bw") __m512i check_block_512(__m512i input, __m512i previous, const Tables512& tables) {
+    // Last lane of previous, then the first three of input.
+    __m512i lanes = _mm512_permutex2var_epi64(input, _mm512_setr_epi64(14, 15, 0, 1, 2, 3, 4, 5), previous);
+    __m512i prev1 = _mm512_alignr_epi8(input, lanes, 15);
+    __m512i special = _mm512_and_si512(
+        _mm512_and_si512(
+            _mm512_shuffle_epi8(tables.byte_1_high, high_nibbles_512(prev1)),
+            _mm512_shuffle_epi8(tables.byte_1_low, _mm512_and_si512(prev1, _mm512_set1_epi8(0x0f)))),
+        _mm512_shuffle_epi8(tables.byte_2_high, high_nibbles_512(input)));
+    __m512i prev2 = _mm512_alignr_epi8(input, lanes, 14);
+    __m512i prev3 = _mm512_alignr_epi8(input, lanes, 13);
+    __m512i third = _mm512_subs_epu8(prev2, _mm512_set1_epi8(static_cast<char>(0xe0 - 0x80)));
+    __m512i fourth = _mm512_subs_epu8(prev3, _mm512_set1_epi8(static_cast<char>(0xf0 - 0x80)));
+    __m512i must_be_2_3_continuation =
+        _mm512_and_si512(_mm512_or_si512(third, fourth), _mm512_set1_epi8(static_cast<char>(0x80)));
+    return _mm512_xor_si512(must_be_2_3_continuation, special);
+}
+
+} // namespace
+
+HELLO_TARGET("avx2") bool validate_utf8_avx2(const char* data, std::size_t size) {
+    __m256i error = _mm256_setzero_si256();
+    __m256i previous = _mm256_setzero_si256();
+    __m256i previous_incomplete = _mm256_setzero_si256();
+    auto step = [&](__m256i input) HELLO_TARGET("avx2") {
+        if (_mm256_movemask_epi8(input) == 0) {
+            error = _mm256_or_si256(error, previous_incomplete);
+        } else {
+            error = _mm256_or_si256(error, check_block_256(input, previous));
+            previous_incomplete =
+                _mm256_subs_epu8(input, _mm256_load_si256(reinterpret_cast<const __m256i*>(incomplete_max + 32)));
+        }
+        previous = input;
+    };
+    std::size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        step(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)));
+    }
+    if (i < size) {
+        char tail[32] = {};
+        std::memcpy(tail, data + i, size - i);
+        step(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(tail)));
+    }
+    error = _mm256_or_si256(error, previous_incomplete);
+    return _mm256_testz_si256(error, error) != 0;
+}
+
+HELLO_TARGET("avx512f,avx512bw") bool validate_utf8_avx512(const char* data, std::size_t size) {
+    __m512i error = _mm512_setzero_si512();
+    __m512i previous = _mm512_setzero_si512();
+    __m512i previous_incomplete = _mm512_setzero_si512();
+    const Tables512 tables{_mm512_load_si512(byte_1_high_512.bytes), _mm512_load_si512(byte_1_low_512.bytes),
+                           _mm512_load_si512(byte_2_high_512.bytes)};
+    const __m512i incomplete_512 = _mm512_load_si512(incomplete_max);
+    auto step = [&](__m512i input) HELLO_TARGET("avx512f,avx512bw") {
+        if (_mm512_movepi8_mask(input) == 0) {
+            error = _mm512_or_si512(error, previous_incomplete);
+        } else {
+            error = _mm512_or_si512(error, check_block_512(input, previous, tables));
+            previous_incomplete = _mm512_subs_epu8(input, incomplete_512);
+        }
+        previous = input;
+    };
+    std::size_t i = 0;
+    for (; i + 64 <= size; i += 64) {
+        step(_mm512_loadu_si512(data + i));
+    }
+    if (i < size) {
+        char tail[64] = {};
+        std::memcpy(tail, data + i, size - i);
+        step(_mm512_loadu_si512(tail));
+    }
+    error = _mm512_or_si512(error, previous_incomplete);
+    return _mm512_test_epi8_mask(error, error) == 0;
+}
+#endif
+
+bool validate_utf8(const char* data, std::size_t size) {
+    using Validator = bool (*)(const char*, std::size_t);
+    static const Validator validator = [] {
+#ifdef HELLO_X86_DISPATCH
+        switch (cpu_level()) {
+        case CpuLevel::avx512:
+            return Validator(validate_utf8_avx512);
+        case CpuLevel::avx2:
+            return Validator(validate_utf8_avx2);
+        default:
+            break;
+        }
+#endif
+#ifdef __SSSE3__
+        return Validator(validate_utf8_ssse3);
+#else
+        return Validator(validate_utf8_ascii_fast_path);
+#endif
+    }();
+    return validator(data, size);
+}
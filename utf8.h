@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+
+#include "cpu_dispatch.h"
+
+// Whether data is well-formed UTF-8 (no overlong forms, surrogates or code
+// points above U+10FFFF). Uses the lookup-table validator of Keiser and
+// Lemire on 64 or 32 bytes at a time when the host has AVX-512 or AVX2, or
+// on 16 when the build targets SSSE3; otherwise SSE2 or word-at-a-time
+// checks that skip all-ASCII runs and a scalar decoder for the rest.
+bool validate_utf8(const char* data, std::size_t size);
+
+// The individual implementations, for benchmarks and dispatch.
+bool validate_utf8_scalar(const char* data, std::size_t size);
+bool validate_utf8_ascii_fast_path(const char* data, std::size_t size);
+#ifdef __SSSE3__
+bool validate_utf8_ssse3(const char* data, std::size_t size);
+#endif
+#ifdef HELLO_X86_DISPATCH
+bool validate_utf8_avx2(const char* data, std::size_t size);
+bool validate_utf8_avx512(const char* data, std::size_t size);
+#endif